@@ -1,95 +1,118 @@
 """
-A very simple Python script running the SIMD benchmarking binary (initially
-produced from C code) with different array size and storing all the results
-into a CSV. It also plots some interesting graphs.
+A very simple Python script plotting the results of a sweep of the SIMD
+benchmarking binary (initially produced from C code): `simdbmk --sweep`
+generates its array once and runs every kernel over prefixes of growing sizes
+and with several thread counts, so all we have to do here is to store its CSV
+rows and plot some interesting graphs.
 
 Oh yeah it's in Python, we were a bit tired of writing C code :)
 """
 
 # stl
+import os
 import csv
-import math
 import argparse
 import subprocess
 
 # 3p
-import numpy
 import matplotlib.pyplot as plt
 
-BENCHMARK_RESULTS = []
+# The header of the CSV rows printed by simdbmk --sweep
+SWEEP_HEADER = "kernel,n,threads,reps,ns,matches"
 
 
-def run_step(binary_name, n):
+def run_sweep(binary_name, max_n, threads, csv_path):
     """
-    Runs the benchmarking binary once and returns the results found at the last
-    line of stdout or throws an exception in case the binary exits with a
-    non-zero exit code
+    Runs the benchmarking binary once in sweep mode, stores its CSV rows in
+    csv_path and returns them, or throws an exception in case the binary exits
+    with a non-zero exit code
     """
-    print("Running {0} with n={1}".format(binary_name, n))
-    p = subprocess.Popen([binary_name + " --size={0}".format(n)],
-            stdin=subprocess.PIPE, stdout=subprocess.PIPE,
-            stderr=subprocess.PIPE, shell=True)
+    cmd = [binary_name, "--sweep", "--size={0}".format(max_n)]
+    if threads:
+        cmd.append("--threads={0}".format(threads))
 
+    print("Running {0}".format(" ".join(cmd)))
+    p = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                         universal_newlines=True)
     out, err = p.communicate()
-    rc = p.returncode
 
-    if rc != 0:
-        print("Ooops, {0} for n={1} exited with the error code {2}".format(
-            binary_name, n, rc))
+    if p.returncode != 0:
+        print("Ooops, {0} exited with the error code {1}".format(
+            binary_name, p.returncode))
         print("------------- STDOUT ------------")
         print(out)
         print("------------- STDERR ------------")
         print(err)
-        raise "Benchmark failed"
-    else:
-        print("{0} ran successfully with n={1}".format(binary_name, n))
-        res = out.splitlines()[-1]
-        bms = res.split()
-        benchmark = [int(bms[0]), int(bms[1]), int(bms[2]), int(bms[3]),
-                float(bms[4]), float(bms[5]), float(bms[6]), float(bms[7])]
-        return benchmark
+        raise RuntimeError("Benchmark failed")
+
+    # Everything before the header is the usual banner
+    lines = out.splitlines()
+    rows = lines[lines.index(SWEEP_HEADER):]
+
+    os.makedirs(os.path.dirname(csv_path), exist_ok=True)
+    with open(csv_path, 'w') as f:
+        f.write("\n".join(rows) + "\n")
+
+    return load_sweep(csv_path)
+
+
+def load_sweep(csv_path):
+    """
+    Reads the rows of a sweep back from a CSV file
+    """
+    with open(csv_path, newline='') as f:
+        return [{"kernel": row["kernel"], "n": int(row["n"]),
+                 "threads": int(row["threads"]),
+                 "us": int(row["ns"]) / 1000.0}
+                for row in csv.DictReader(f)]
 
 
-def run_benchmark(binary_name, smpls):
+def series(rows, kernel, threads):
     """
-    Runs the benchmark for n varying between 10^a to 10^b by powers of ten
+    The sizes and running times (in µs) of kernel with that many threads
     """
-    benchmark = []
-    for n in smpls:
-        print(n)
-        benchmark.append(run_step(binary_name, n))
+    points = sorted((r["n"], r["us"]) for r in rows
+                    if r["kernel"] == kernel and r["threads"] == threads)
+    return [p[0] for p in points], [p[1] for p in points]
+
 
-    # Let's dump the results into a good old CSV file
-    with open("./results/benchmark.csv", 'w', newline='') as f:
-        writer = csv.writer(f)
-        writer.writerows(benchmark)
+def plot_sweep(rows):
+    """
+    Plots the running times of the four historical implementations and the
+    performance gains between them, the multithreaded ones with the largest
+    thread count of the sweep
+    """
+    threads = max(r["threads"] for r in rows)
+
+    n, naive = series(rows, "find", 1)
+    _, vect = series(rows, "vect_find", 1)
+    _, mt = series(rows, "thread_find_scalar", threads)
+    _, mt_vect = series(rows, "thread_find_vect", threads)
 
-    # And let's display some fancy graphs
     fig = plt.figure()
     timeplt = fig.add_subplot(121)
 
-    n = smpls
-
-    bcm_np = numpy.array(benchmark)
-    timeplt.loglog(n, bcm_np[:, 0])
-    timeplt.loglog(n, bcm_np[:, 1])
-    timeplt.loglog(n, bcm_np[:, 2])
-    timeplt.loglog(n, bcm_np[:, 3])
+    timeplt.loglog(n, naive)
+    timeplt.loglog(n, vect)
+    timeplt.loglog(n, mt)
+    timeplt.loglog(n, mt_vect)
 
     timeplt.set_xlabel("n")
     timeplt.set_ylabel("t (µs)")
     timeplt.set_title("Computation time")
 
-    timeplt.legend(["Naive", "Vectorized", "Multi-threaded",
-        "Multi-threaded + Vectorized"], loc="upper left")
+    timeplt.legend(["Naive", "Vectorized",
+        "Multi-threaded ({0} threads)".format(threads),
+        "Multi-threaded + Vectorized ({0} threads)".format(threads)],
+        loc="upper left")
 
     indexplt = fig.add_subplot(122)
     indexplt.set_xscale('log')
     indexplt.set_yscale('linear')
-    indexplt.plot(n, bcm_np[:, 4])
-    indexplt.plot(n, bcm_np[:, 5])
-    indexplt.plot(n, bcm_np[:, 6])
-    indexplt.plot(n, bcm_np[:, 7])
+    indexplt.plot(n, [a / b for a, b in zip(naive, vect)])
+    indexplt.plot(n, [a / b for a, b in zip(mt, mt_vect)])
+    indexplt.plot(n, [a / b for a, b in zip(naive, mt)])
+    indexplt.plot(n, [a / b for a, b in zip(naive, mt_vect)])
 
     indexplt.set_xlabel("n")
     indexplt.set_ylabel("Performance Gain")
@@ -106,17 +129,24 @@ def run_benchmark(binary_name, smpls):
     plt.show()
 
 if __name__ == "__main__":
-    parser = argparse.ArgumentParser(description='Takes a list of floats '
-             'and runs our SIMD benchmarking binary ("./simdbmk") for every '
-             '10^k, where k is an element of the list. It puts the results of '
-             'the benchmark in "./benchmark.csv" and displays a graph using '
+    parser = argparse.ArgumentParser(description='Runs our SIMD benchmarking '
+             'binary ("./simdbmk") once in sweep mode, for every size from '
+             '1000 to SIZE (20 of them per power of ten), puts its results in '
+             '"./results/benchmark.csv" and displays a graph using '
              'matplotlib.')
-    parser.add_argument('powers', metavar='Ps', type=float, nargs='*',
-            help='The list of powers of ten to run simdbmk with as an '
-                'argument for the size of the generated array (in case the '
-                'power of ten is not an integer it will be floored).')
+    parser.add_argument('--size', type=int, default=10**8,
+            help='The size of the largest prefix of the array (default: '
+                '10^8).')
+    parser.add_argument('--threads', type=str, default=None,
+            help='A comma-separated list of thread counts (default: 1 and '
+                'the number of cores).')
+    parser.add_argument('--plot-only', action='store_true',
+            help='Only plots the results of a previous sweep.')
     args = parser.parse_args()
-    if not args.powers:
-        args.powers = [x/100.0 for x in range(500, 905, 5)]
-    run_benchmark("gcc_build/simdbmk", [math.floor(10**p) for p in args.powers])
 
+    csv_path = "./results/benchmark.csv"
+    if args.plot_only:
+        plot_sweep(load_sweep(csv_path))
+    else:
+        plot_sweep(run_sweep("gcc_build/simdbmk", args.size, args.threads,
+                             csv_path))
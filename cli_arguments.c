@@ -17,9 +17,16 @@
  *
  * =====================================================================================
  */
+
+// strtok_r
+#define _XOPEN_SOURCE 600
+
 #include "cli_arguments.h"
 
 #include <stdlib.h>
+#include <string.h>
+
+#include "utilities.h"
 
 // These constants aren't needed in the header file so let's put them here to
 // prevent name conflicts
@@ -41,9 +48,36 @@ static struct argp_option options[] = {
     { "limit-search", 'k', "COUNT", OPTION_ARG_OPTIONAL, "Limits the search "
         "to the first k occurences found (default: -1 i.e. no limit)"},
     { "lookup", 'f', "COUNT", OPTION_ARG_OPTIONAL, "The value to search for "
-        "(must be between a and b, defaults to 12)."}
+        "(must be between a and b, defaults to 12)."},
+    { "sweep", 's', 0, 0, "Runs every kernel over prefixes of the array, of "
+        "sizes growing from 1000 to n, and prints one CSV row per kernel, "
+        "size and thread count instead of the usual tables."},
+    { "threads", 't', "LIST", 0, "A comma-separated list of thread counts "
+        "for --sweep (default: 1 and the number of cores)."},
+    { 0 }
 };
 
+/**
+ * Parses a comma-separated list of positive ints into the thread counts of
+ * arguments, the other entries being skipped. A list without a single one of
+ * them is an error (argp_error exits).
+ */
+static void parse_thread_counts(char *str, struct argp_state *state){
+    char *tok, *saveptr;
+    struct arguments *arguments = state->input;
+
+    arguments->n_thread_counts = 0;
+    for(tok = strtok_r(str, ",", &saveptr);
+        tok != NULL && arguments->n_thread_counts < MAX_THREAD_COUNTS;
+        tok = strtok_r(NULL, ",", &saveptr)){
+        if(atoi(tok) > 0)
+            arguments->thread_counts[arguments->n_thread_counts++] = atoi(tok);
+    }
+
+    if(arguments->n_thread_counts == 0)
+        argp_error(state, "--threads needs at least one positive count");
+}
+
 static error_t parse_opt(int key, char *arg, struct argp_state *state) {
     struct arguments *arguments = state->input;
     switch (key) {
@@ -52,6 +86,8 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
         case 'b': arguments->b = arg ? atoi (arg) : 100; break;
         case 'k': arguments->k = arg ? atoi (arg) : -1; break;
         case 'f': arguments->f = arg ? atoi (arg) : 12; break;
+        case 's': arguments->sweep = 1; break;
+        case 't': parse_thread_counts(arg, state); break;
         case ARGP_KEY_ARG: return 0;
         default: return ARGP_ERR_UNKNOWN;
     }
@@ -70,6 +106,10 @@ struct arguments* parse_cli_arguments(int argc, char** argv){
     arguments->b = 100;
     arguments->k = -1;
     arguments->f = 12;
+    arguments->sweep = 0;
+    arguments->thread_counts[0] = 1;
+    arguments->thread_counts[1] = get_number_of_cores();
+    arguments->n_thread_counts = (arguments->thread_counts[1] > 1) ? 2 : 1;
 
     /* Parse our arguments; every option seen by parse_opt will be
        reflected in arguments. */
@@ -23,12 +23,20 @@
 
 #include <argp.h>
 
+// The most thread counts --threads takes
+#define MAX_THREAD_COUNTS 64
+
 struct arguments {
     int n;
     int a;
     int b;
     int k;
     int f;
+    // --sweep: every kernel over prefixes of the array instead of the usual
+    // tables, with each of the n_thread_counts thread counts
+    int sweep;
+    int thread_counts[MAX_THREAD_COUNTS];
+    int n_thread_counts;
 };
 
 struct arguments* parse_cli_arguments(int argc, char ** argv);
@@ -0,0 +1,290 @@
+/*
+ * ============================================================================
+ *
+ *       Filename:  column.c
+ *
+ *    Description:  Implementation of our updatable columns and of the
+ *                  incremental maintenance of their derived structures.
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 06:07:38
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  agent (agent@local)
+ *
+ * ============================================================================
+ */
+
+// pthread rwlocks and posix_memalign
+#define _XOPEN_SOURCE 600
+
+#include "column.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "find.h"
+#include "thread_find.h"
+#include "utilities.h"
+
+/**
+ * Adds delta to the count of v.
+ */
+static void count_value(struct column *col, int v, int delta){
+    if(v >= col->a && v <= col->b)
+        col->counts[v - col->a] += delta;
+    else
+        col->out_of_domain += delta;
+}
+
+/**
+ * Recomputes the summary of the j-th block from scratch.
+ */
+static void summarize_block(struct column *col, int j){
+    int i, end;
+
+    col->block_min[j] = INT_MAX;
+    col->block_max[j] = INT_MIN;
+
+    end = min((j + 1) * COLUMN_BLOCK, col->n);
+    for(i = j * COLUMN_BLOCK; i < end; i++){
+        col->block_min[j] = min(col->block_min[j], col->U[i]);
+        col->block_max[j] = max(col->block_max[j], col->U[i]);
+    }
+}
+
+/**
+ * Makes room for at least n elements, doubling the capacity so that appends
+ * are amortized. The capacity is always a multiple of COLUMN_BLOCK.
+ */
+static void reserve(struct column *col, int n){
+    int capacity, j;
+    int *U;
+
+    if(n <= col->capacity)
+        return;
+
+    capacity = max(2 * col->capacity, n);
+    capacity += (COLUMN_BLOCK - capacity % COLUMN_BLOCK) % COLUMN_BLOCK;
+
+    // realloc wouldn't keep U 32 bytes aligned
+    posix_memalign((void**) &U, 32, sizeof(int) * capacity);
+    if(col->U != NULL){
+        memcpy(U, col->U, sizeof(int) * col->n);
+        free(col->U);
+    }
+    col->U = U;
+
+    col->block_min = realloc(col->block_min,
+                             sizeof(int) * (capacity / COLUMN_BLOCK));
+    col->block_max = realloc(col->block_max,
+                             sizeof(int) * (capacity / COLUMN_BLOCK));
+    for(j = col->capacity / COLUMN_BLOCK; j < capacity / COLUMN_BLOCK; j++){
+        col->block_min[j] = INT_MAX;
+        col->block_max[j] = INT_MIN;
+    }
+
+    col->capacity = capacity;
+}
+
+struct column* column_create(int *U, int n, int a, int b){
+    struct column *col;
+
+    col = malloc(sizeof(struct column));
+    col->U = NULL;
+    col->n = 0;
+    col->capacity = 0;
+    col->a = a;
+    col->b = b;
+    col->counts = calloc(b - a + 1, sizeof(int));
+    col->out_of_domain = 0;
+    col->block_min = NULL;
+    col->block_max = NULL;
+    pthread_rwlock_init(&col->lock, NULL);
+
+    reserve(col, max(n, COLUMN_BLOCK));
+
+    // Building from scratch is nothing more than a big append
+    column_append(col, U, n);
+
+    return col;
+}
+
+void column_free(struct column *col){
+    pthread_rwlock_destroy(&col->lock);
+    free(col->U);
+    free(col->counts);
+    free(col->block_min);
+    free(col->block_max);
+    free(col);
+}
+
+void column_append(struct column *col, int *vals, int m){
+    int i, j;
+
+    pthread_rwlock_wrlock(&col->lock);
+
+    reserve(col, col->n + m);
+
+    // The blocks only get new elements, their bounds can only widen
+    for(i = 0; i < m; i++){
+        col->U[col->n + i] = vals[i];
+        count_value(col, vals[i], 1);
+
+        j = (col->n + i) / COLUMN_BLOCK;
+        col->block_min[j] = min(col->block_min[j], vals[i]);
+        col->block_max[j] = max(col->block_max[j], vals[i]);
+    }
+
+    col->n += m;
+
+    pthread_rwlock_unlock(&col->lock);
+}
+
+int column_overwrite(struct column *col, int i_start, int *vals, int m){
+    int i, j, j_start, old;
+    char *stale;
+
+    pthread_rwlock_wrlock(&col->lock);
+
+    if(i_start < 0 || m < 0 || i_start + m > col->n){
+        pthread_rwlock_unlock(&col->lock);
+        return -1;
+    }
+
+    // The touched blocks whose bounds may have to shrink
+    j_start = i_start / COLUMN_BLOCK;
+    stale = calloc((i_start + m) / COLUMN_BLOCK - j_start + 1, sizeof(char));
+
+    for(i = i_start; i < i_start + m; i++){
+        old = col->U[i];
+        if(old == vals[i - i_start])
+            continue;
+
+        count_value(col, old, -1);
+        count_value(col, vals[i - i_start], 1);
+        col->U[i] = vals[i - i_start];
+
+        // Widening the bounds is free, shrinking them requires to look at the
+        // whole block again, but only if the value we removed was on a bound
+        j = i / COLUMN_BLOCK;
+        if(old == col->block_min[j] || old == col->block_max[j])
+            stale[j - j_start] = 1;
+        col->block_min[j] = min(col->block_min[j], col->U[i]);
+        col->block_max[j] = max(col->block_max[j], col->U[i]);
+    }
+
+    for(j = j_start; j <= (i_start + m) / COLUMN_BLOCK; j++){
+        if(stale[j - j_start])
+            summarize_block(col, j);
+    }
+
+    free(stale);
+
+    pthread_rwlock_unlock(&col->lock);
+
+    return 0;
+}
+
+/**
+ * Counts the elements between lo and hi in the blocks that may hold some.
+ */
+static int count_range_in_blocks(struct column *col, int lo, int hi){
+    int j, c = 0;
+
+    for(j = 0; j * COLUMN_BLOCK < col->n; j++){
+        if(col->block_max[j] < lo || col->block_min[j] > hi)
+            continue;
+        c += vect_count_range(col->U, j * COLUMN_BLOCK,
+                              min((j + 1) * COLUMN_BLOCK, col->n), 1, lo, hi);
+    }
+
+    return c;
+}
+
+int column_count(struct column *col, int val){
+    int c;
+
+    pthread_rwlock_rdlock(&col->lock);
+
+    if(val >= col->a && val <= col->b)
+        c = col->counts[val - col->a];
+    else if(col->out_of_domain == 0)
+        c = 0;
+    else
+        c = count_range_in_blocks(col, val, val);
+
+    pthread_rwlock_unlock(&col->lock);
+
+    return c;
+}
+
+int column_count_range(struct column *col, int lo, int hi){
+    int o, c = 0;
+
+    pthread_rwlock_rdlock(&col->lock);
+
+    // Let's walk through the offsets of the counts rather than the values
+    // themselves, v++ would overflow once v reaches INT_MAX
+    if(lo <= col->b && hi >= col->a){
+        for(o = max(lo, col->a) - col->a; o <= min(hi, col->b) - col->a; o++)
+            c += col->counts[o];
+    }
+
+    // The parts of [lo, hi] outside of the domain can only be scanned for
+    // (and there are none below INT_MIN or above INT_MAX)
+    if(col->out_of_domain > 0){
+        if(lo < col->a && col->a > INT_MIN)
+            c += count_range_in_blocks(col, lo, min(hi, col->a - 1));
+        if(hi > col->b && col->b < INT_MAX)
+            c += count_range_in_blocks(col, max(lo, col->b + 1), hi);
+    }
+
+    pthread_rwlock_unlock(&col->lock);
+
+    return c;
+}
+
+int column_find(struct column *col, int val, int **ind_val){
+    int first, last, c, c_run;
+    int *run_ind_val;
+
+    pthread_rwlock_rdlock(&col->lock);
+
+    (*ind_val) = NULL;
+    c = 0;
+
+    if(val < col->a || val > col->b || col->counts[val - col->a] > 0){
+        // Every run [first, last) of consecutive blocks that may hold val is
+        // searched on its own, the other blocks are skipped
+        for(first = 0; first * COLUMN_BLOCK < col->n; first = last + 1){
+            for(last = first; last * COLUMN_BLOCK < col->n &&
+                col->block_min[last] <= val && val <= col->block_max[last];
+                last++);
+
+            if(last == first)
+                continue;
+
+            c_run = thread_find(col->U, first * COLUMN_BLOCK,
+                                min(last * COLUMN_BLOCK, col->n), 1, val,
+                                &run_ind_val, -1, THREAD_FIND_AUTO);
+
+            // The runs come in order, their positions are simply appended
+            if(c == 0){
+                free(*ind_val);
+                (*ind_val) = run_ind_val;
+            } else {
+                (*ind_val) = realloc((*ind_val), (c + c_run) * sizeof(int));
+                memcpy(*ind_val + c, run_ind_val, c_run * sizeof(int));
+                free(run_ind_val);
+            }
+            c += c_run;
+        }
+    }
+
+    pthread_rwlock_unlock(&col->lock);
+
+    return c;
+}
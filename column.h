@@ -0,0 +1,95 @@
+/*
+ * ============================================================================
+ *
+ *       Filename:  column.h
+ *
+ *    Description:  A growable array of ints (a column) accepting appends and
+ *                  overwrites while keeping its derived structures (the count
+ *                  of every value and a min/max summary of every block)
+ *                  up to date incrementally, so that find and count queries
+ *                  never need a rebuild.
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 06:07:38
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  agent (agent@local)
+ *
+ * ============================================================================
+ */
+
+#ifndef _COLUMN_H_
+#define _COLUMN_H_
+
+#include <pthread.h>
+
+// The number of elements summarized by each block_min/block_max entry
+#define COLUMN_BLOCK 4096
+
+/**
+ * U holds n elements (and room for capacity of them, 32 bytes aligned).
+ *
+ * counts[v - a] is the number of occurences of v for every v in [a, b], the
+ * domain given at creation. Values outside of it can still be stored, they're
+ * only counted as a whole in out_of_domain and looked for the hard way.
+ *
+ * block_min[j] and block_max[j] bound the values of
+ * U[j * COLUMN_BLOCK, (j + 1) * COLUMN_BLOCK): the searches skip the blocks
+ * that can't contain what they look for.
+ *
+ * Queries take lock for reading and updates for writing, so a column can be
+ * shared between threads.
+ */
+struct column{
+    int *U;
+    int n;
+    int capacity;
+    int a;
+    int b;
+    int *counts;
+    int out_of_domain;
+    int *block_min;
+    int *block_max;
+    pthread_rwlock_t lock;
+};
+
+/**
+ * Builds a column holding a copy of the n first elements of U, with per-value
+ * counts over [a, b]. That's the only full build a column ever goes through.
+ */
+struct column* column_create(int *U, int n, int a, int b);
+
+void column_free(struct column *col);
+
+/**
+ * Appends the m elements of vals at the end of the column.
+ */
+void column_append(struct column *col, int *vals, int m);
+
+/**
+ * Overwrites the elements i_start to i_start + m - 1 of the column with the m
+ * elements of vals. Returns -1 (and changes nothing) if that range doesn't
+ * exist.
+ */
+int column_overwrite(struct column *col, int i_start, int *vals, int m);
+
+/**
+ * The number of occurences of val in the column: a lookup in counts as long
+ * as val is in [a, b].
+ */
+int column_count(struct column *col, int val);
+
+/**
+ * The number of elements of the column between lo and hi.
+ */
+int column_count_range(struct column *col, int lo, int hi);
+
+/**
+ * The same as thread_find over the whole column (with ver =
+ * THREAD_FIND_AUTO), restricted to the blocks that can contain val. Nothing is
+ * scanned at all when counts says val isn't there.
+ */
+int column_find(struct column *col, int val, int **ind_val);
+
+#endif
@@ -21,15 +21,59 @@
 
 #include "find.h"
 
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
 #include <immintrin.h>
 
+#include "trace.h"
+#include "utilities.h"
+#include "vect_utils.h"
+
+#define add_j(j) \
+    TRACE_BEGIN(t_realloc); \
+    (*ind_val) = realloc((*ind_val), (c + 1)*sizeof(int)); \
+    TRACE_END(t_realloc, "realloc"); \
+    (*ind_val)[c] = j; \
+    c++;
+
 #define test_U_j(j) \
     if(U[j] == val){ \
-        (*ind_val) = realloc((*ind_val), (c + 1)*sizeof(int)); \
-        (*ind_val)[c] = j; \
-        c++; \
+        add_j(j) \
      }
 
+// The first size of the result array of vect_find_compress
+#define COMPRESS_INITIAL_SIZE 64
+
+// For every 8 bits comparison mask, the permutation bringing the lanes set in
+// the mask to the beginning of a register (in order)
+static int compress_lut[256][8] __attribute__ ((aligned(32)));
+static pthread_once_t compress_lut_once = PTHREAD_ONCE_INIT;
+
+static void init_compress_lut(){
+    int mask, j, c;
+
+    for(mask = 0; mask < 256; mask++){
+        c = 0;
+        for(j = 0; j < 8; j++){
+            if(mask & (1 << j))
+                compress_lut[mask][c++] = j;
+        }
+        for( ; c < 8; c++)
+            compress_lut[mask][c] = 0;
+    }
+}
+
+/**
+ * The positions of the lanes set in mask, packed at the beginning of a
+ * register (idx_vect holding the positions of all 8 lanes of the block).
+ */
+VECT_INLINE __m256i compress_positions(__m256i idx_vect, unsigned int mask){
+    return _mm256_permutevar8x32_epi32(idx_vect,
+                                       *((__m256i*) compress_lut[mask]));
+}
+
 
 /**
  * Looks for val in U between the indexes i_start and i_end and jumping by
@@ -69,41 +113,592 @@ int find(int *U, int i_start, int i_end, int i_step, int val, int **ind_val){
 
 int vect_find(int *U, int i_start, int i_end, int i_step, int val,
               int **ind_val){
-    int i;
+    int base;
     int c = 0;
+    unsigned int mask, lanes;
+    struct vect_scan sc;
 
-    __m256i cmp_vect __attribute__ ((aligned(32)));
+    __m256i cmp_vect __attribute__ ((aligned(32))),
+            v        __attribute__ ((aligned(32)));
 
     // Let's build our comparison vector
     cmp_vect = _mm256_set1_epi32(val);
 
     (*ind_val) = NULL;
 
-    for(i = i_start; i < i_end - 6; i += i_step * 8){
-        // Let's go from a cmp_vect to a 4 bits mask with a dirty (but
-        // efficient since we don't duplicate variables in memory, we just
-        // access U[i] like an array of four ints since we know we can do so
-        // thanks to the condition on the for)
+    // Every block holds U[base], U[base + i_step], ..., U[base + 7*i_step],
+    // the lanes outside of [i_start, i_end) being masked off (see
+    // vect_utils.h for how these get loaded depending on i_step and on the
+    // alignment of U + i_start)
+    vect_scan_init(&sc, U, i_start, i_end, i_step);
+    while(vect_scan_next(&sc, &base, &v, &lanes)){
+        mask = vect_eq_mask(v, cmp_vect) & lanes;
 
         // If the whole mask is null, no matching element: let's move forward
-        if(!_mm256_movemask_epi8(_mm256_cmpeq_epi32(cmp_vect, *((__m256i*)(U + i)))))
+        if(!mask)
             continue;
 
-        // Or else let's analyse things one piece at a time
-        test_U_j(i);
-        test_U_j(i + 1);
-        test_U_j(i + 2);
-        test_U_j(i + 3);
-        test_U_j(i + 4);
-        test_U_j(i + 5);
-        test_U_j(i + 6);
-        test_U_j(i + 7);
-    }
-
-    // Let's finish the job for the potentially remaining last few (3 at most)
-    // elements
-    for( ; i < i_end; i++){
-        test_U_j(i);
+        // Or else let's add the matching positions, one set bit at a time
+        while(mask){
+            add_j(base + i_step * __builtin_ctz(mask))
+            mask &= mask - 1;
+        }
+    }
+
+    return c;
+}
+
+int vect_count(int *U, int i_start, int i_end, int i_step, int val){
+    int base;
+    int c = 0;
+    unsigned int lanes;
+    struct vect_scan sc;
+
+    __m256i cmp_vect __attribute__ ((aligned(32))),
+            v        __attribute__ ((aligned(32)));
+
+    cmp_vect = _mm256_set1_epi32(val);
+
+    // No realloc to fear here, so instead of skipping the empty blocks we
+    // simply add up the number of bits set in the comparison mask: one
+    // movemask per 8 elements and not a single branch on the data.
+    vect_scan_init(&sc, U, i_start, i_end, i_step);
+    while(vect_scan_next(&sc, &base, &v, &lanes)){
+        c += __builtin_popcount(vect_eq_mask(v, cmp_vect) & lanes);
+    }
+
+    return c;
+}
+
+int vect_find_fill(int *U, int i_start, int i_end, int i_step, int val,
+                   int *ind_val, int max_c){
+    int base;
+    int c = 0;
+    unsigned int mask, lanes;
+    struct vect_scan sc;
+
+    __m256i cmp_vect __attribute__ ((aligned(32))),
+            v        __attribute__ ((aligned(32)));
+
+    cmp_vect = _mm256_set1_epi32(val);
+
+    vect_scan_init(&sc, U, i_start, i_end, i_step);
+    while(c < max_c && vect_scan_next(&sc, &base, &v, &lanes)){
+        mask = vect_eq_mask(v, cmp_vect) & lanes;
+
+        // Let's walk through the bits set in the mask, lowest first so
+        // that the positions stay sorted
+        while(mask && c < max_c){
+            ind_val[c++] = base + i_step * __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+
+    return c;
+}
+
+int vect_find_compress(int *U, int i_start, int i_end, int i_step, int val,
+                       int **ind_val){
+    int base, size;
+    int c = 0;
+    unsigned int mask, lanes;
+    struct vect_scan sc;
+
+    __m256i cmp_vect __attribute__ ((aligned(32))),
+            v        __attribute__ ((aligned(32)));
+
+    pthread_once(&compress_lut_once, &init_compress_lut);
+
+    cmp_vect = _mm256_set1_epi32(val);
+
+    // There must always be room for 8 more positions after the c first ones
+    size = COMPRESS_INITIAL_SIZE;
+    (*ind_val) = malloc(size * sizeof(int));
+
+    vect_scan_init(&sc, U, i_start, i_end, i_step);
+    while(vect_scan_next(&sc, &base, &v, &lanes)){
+        if(c + 8 > size){
+            TRACE_BEGIN(t_realloc);
+            size *= 2;
+            (*ind_val) = realloc((*ind_val), size * sizeof(int));
+            TRACE_END(t_realloc, "realloc");
+        }
+
+        mask = vect_eq_mask(v, cmp_vect) & lanes;
+
+        // Not a single branch depending on the data: we always store 8
+        // positions and only move forward by the number of actual matches
+        _mm256_storeu_si256((__m256i*)(*ind_val + c), compress_positions(
+            _mm256_add_epi32(_mm256_set1_epi32(base), sc.st.gather_idx), mask));
+        c += __builtin_popcount(mask);
+    }
+
+    // Let's give back what we didn't use
+    (*ind_val) = realloc((*ind_val), max(c, 1) * sizeof(int));
+
+    return c;
+}
+
+int vect_find_compress_fill(int *U, int i_start, int i_end, int i_step,
+                            int val, int *ind_val, int max_c){
+    int base;
+    int c = 0;
+    unsigned int mask, lanes;
+    struct vect_scan sc;
+
+    __m256i cmp_vect __attribute__ ((aligned(32))),
+            v        __attribute__ ((aligned(32)));
+
+    pthread_once(&compress_lut_once, &init_compress_lut);
+
+    cmp_vect = _mm256_set1_epi32(val);
+
+    vect_scan_init(&sc, U, i_start, i_end, i_step);
+    while(c < max_c && vect_scan_next(&sc, &base, &v, &lanes)){
+        mask = vect_eq_mask(v, cmp_vect) & lanes;
+
+        if(c + 8 <= max_c){
+            _mm256_storeu_si256((__m256i*)(ind_val + c), compress_positions(
+                _mm256_add_epi32(_mm256_set1_epi32(base), sc.st.gather_idx),
+                mask));
+            c += __builtin_popcount(mask);
+        } else {
+            // Close to the end of our slice, the 8 positions store could
+            // overwrite somebody else's results
+            while(mask && c < max_c){
+                ind_val[c++] = base + i_step * __builtin_ctz(mask);
+                mask &= mask - 1;
+            }
+        }
+    }
+
+    return c;
+}
+
+int vect_count_range(int *U, int i_start, int i_end, int i_step, int lo,
+                     int hi){
+    int base;
+    int c = 0;
+    unsigned int lanes;
+    struct vect_scan sc;
+
+    __m256i lo_vect __attribute__ ((aligned(32))),
+            hi_vect __attribute__ ((aligned(32))),
+            v       __attribute__ ((aligned(32)));
+
+    lo_vect = _mm256_set1_epi32(lo);
+    hi_vect = _mm256_set1_epi32(hi);
+
+    vect_scan_init(&sc, U, i_start, i_end, i_step);
+    while(vect_scan_next(&sc, &base, &v, &lanes)){
+        c += __builtin_popcount(vect_range_mask(v, lo_vect, hi_vect) & lanes);
+    }
+
+    return c;
+}
+
+int vect_find_range_fill(int *U, int i_start, int i_end, int i_step, int lo,
+                         int hi, int *ind_val, int max_c){
+    int base;
+    int c = 0;
+    unsigned int mask, lanes;
+    struct vect_scan sc;
+
+    __m256i lo_vect __attribute__ ((aligned(32))),
+            hi_vect __attribute__ ((aligned(32))),
+            v       __attribute__ ((aligned(32)));
+
+    lo_vect = _mm256_set1_epi32(lo);
+    hi_vect = _mm256_set1_epi32(hi);
+
+    vect_scan_init(&sc, U, i_start, i_end, i_step);
+    while(c < max_c && vect_scan_next(&sc, &base, &v, &lanes)){
+        mask = vect_range_mask(v, lo_vect, hi_vect) & lanes;
+
+        while(mask && c < max_c){
+            ind_val[c++] = base + i_step * __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+
+    return c;
+}
+
+int vect_find_bitmap(int *U, int i_start, int i_end, int i_step, int val,
+                     unsigned char *bitmap){
+    int base, slot;
+    int c = 0;
+    unsigned int mask, lanes;
+    struct vect_scan sc;
+
+    __m256i cmp_vect __attribute__ ((aligned(32))),
+            v        __attribute__ ((aligned(32)));
+
+    cmp_vect = _mm256_set1_epi32(val);
+
+    vect_scan_init(&sc, U, i_start, i_end, i_step);
+    while(vect_scan_next(&sc, &base, &v, &lanes)){
+        mask = vect_eq_mask(v, cmp_vect) & lanes;
+        c += __builtin_popcount(mask);
+
+        // The slot of the first lane of the block. The blocks are 8 slots
+        // apart so, as long as U + i_start is aligned (or i_step isn't 1),
+        // every slot is a multiple of 8 and the mask is one byte of the
+        // bitmap. Otherwise the block straddles two bytes.
+        slot = (base - i_start) / i_step;
+        if(slot < 0){
+            mask >>= -slot;
+            slot = 0;
+        }
+
+        if(slot % 8 == 0)
+            bitmap[slot / 8] = mask;
+        else {
+            bitmap[slot / 8] |= (mask << (slot % 8)) & 0xFF;
+            bitmap[slot / 8 + 1] |= mask >> (8 - slot % 8);
+        }
+    }
+
+    return c;
+}
+
+int vect_count_runs(int *U, int i_start, int i_end, int i_step, int val){
+    int base;
+    int c = 0;
+    unsigned int mask, lanes, carry = 0;
+    struct vect_scan sc;
+
+    __m256i cmp_vect __attribute__ ((aligned(32))),
+            v        __attribute__ ((aligned(32)));
+
+    cmp_vect = _mm256_set1_epi32(val);
+
+    // A run starts on every match whose predecessor isn't one, the
+    // predecessor of lane 0 being lane 7 of the previous block
+    vect_scan_init(&sc, U, i_start, i_end, i_step);
+    while(vect_scan_next(&sc, &base, &v, &lanes)){
+        mask = vect_eq_mask(v, cmp_vect) & lanes;
+        c += __builtin_popcount(mask & ~((mask << 1) | carry));
+        carry = mask >> 7;
+    }
+
+    return c;
+}
+
+int vect_find_runs_fill(int *U, int i_start, int i_end, int i_step, int val,
+                        int *runs, int max_runs){
+    int base, j, len;
+    int c = 0, r = 0;
+    unsigned int mask, lanes, carry = 0;
+    struct vect_scan sc;
+
+    __m256i cmp_vect __attribute__ ((aligned(32))),
+            v        __attribute__ ((aligned(32)));
+
+    cmp_vect = _mm256_set1_epi32(val);
+
+    vect_scan_init(&sc, U, i_start, i_end, i_step);
+    while(vect_scan_next(&sc, &base, &v, &lanes)){
+        mask = vect_eq_mask(v, cmp_vect) & lanes;
+        carry = carry && (mask & 1);
+
+        // One iteration per run of set bits in the mask
+        while(mask){
+            j = __builtin_ctz(mask);
+            len = __builtin_ctz(~(mask >> j));
+
+            if(carry)
+                // The run of the previous block goes on
+                runs[2 * r - 1] += len;
+            else if(r < max_runs){
+                runs[2 * r] = base + j * i_step;
+                runs[2 * r + 1] = len;
+                r++;
+            } else
+                return c;
+
+            c += len;
+            carry = (j + len == 8);
+            mask &= ~(((1u << len) - 1) << j);
+        }
+    }
+
+    return c;
+}
+
+void vect_histogram(int *U, int i_start, int i_end, int i_step, int a, int b,
+                    int *hist){
+    int base, j, width;
+    int *copies;
+    int idx[8] __attribute__ ((aligned(32)));
+    unsigned int mask, lanes;
+    struct vect_scan sc;
+
+    __m256i a_vect __attribute__ ((aligned(32))),
+            b_vect __attribute__ ((aligned(32))),
+            v      __attribute__ ((aligned(32)));
+
+    a_vect = _mm256_set1_epi32(a);
+    b_vect = _mm256_set1_epi32(b);
+
+    width = b - a + 1;
+    copies = calloc(HISTOGRAM_COPIES * width, sizeof(int));
+
+    vect_scan_init(&sc, U, i_start, i_end, i_step);
+    while(vect_scan_next(&sc, &base, &v, &lanes)){
+        mask = vect_range_mask(v, a_vect, b_vect) & lanes;
+        _mm256_store_si256((__m256i*) idx, _mm256_sub_epi32(v, a_vect));
+
+        // AVX2 can't scatter, the increments themselves are scalar. Lane j
+        // goes to copy j % HISTOGRAM_COPIES.
+        if(mask == 0xFF){
+            for(j = 0; j < 8; j++)
+                copies[(j % HISTOGRAM_COPIES) * width + idx[j]]++;
+        } else {
+            while(mask){
+                j = __builtin_ctz(mask);
+                copies[(j % HISTOGRAM_COPIES) * width + idx[j]]++;
+                mask &= mask - 1;
+            }
+        }
+    }
+
+    // Let's sum the copies up
+    memcpy(hist, copies, width * sizeof(int));
+    for(j = 1; j < HISTOGRAM_COPIES; j++)
+        vect_add_ints(hist, copies + j * width, width);
+
+    free(copies);
+}
+
+void vect_aggregate(int *U, int i_start, int i_end, int i_step, int lo,
+                    int hi, struct aggregate *agg){
+    int base, j;
+    long long sums[4] __attribute__ ((aligned(32)));
+    int mins[8] __attribute__ ((aligned(32))),
+        maxs[8] __attribute__ ((aligned(32)));
+    unsigned int lanes;
+    struct vect_scan sc;
+
+    __m256i lo_vect  __attribute__ ((aligned(32))),
+            hi_vect  __attribute__ ((aligned(32))),
+            sum_vect __attribute__ ((aligned(32))),
+            min_vect __attribute__ ((aligned(32))),
+            max_vect __attribute__ ((aligned(32))),
+            lane_mask __attribute__ ((aligned(32))),
+            v        __attribute__ ((aligned(32)));
+
+    lo_vect = _mm256_set1_epi32(lo);
+    hi_vect = _mm256_set1_epi32(hi);
+    sum_vect = _mm256_setzero_si256();
+    min_vect = _mm256_set1_epi32(INT_MAX);
+    max_vect = _mm256_set1_epi32(INT_MIN);
+
+    agg->n = 0;
+    agg->count_if = 0;
+
+    // Everything in one pass over U: the sums are accumulated on 64 bits
+    // (4 lanes of them) so that they can't overflow, the masked off lanes of
+    // the partial blocks are zeroes which don't change the sum but would
+    // change the min or the max, hence the blends.
+    vect_scan_init(&sc, U, i_start, i_end, i_step);
+    while(vect_scan_next(&sc, &base, &v, &lanes)){
+        sum_vect = _mm256_add_epi64(sum_vect, _mm256_add_epi64(
+                        _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)),
+                        _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1))));
+
+        if(lanes == 0xFF){
+            min_vect = _mm256_min_epi32(min_vect, v);
+            max_vect = _mm256_max_epi32(max_vect, v);
+        } else {
+            lane_mask = vect_lane_mask(lanes);
+            min_vect = _mm256_min_epi32(min_vect, _mm256_blendv_epi8(
+                            _mm256_set1_epi32(INT_MAX), v, lane_mask));
+            max_vect = _mm256_max_epi32(max_vect, _mm256_blendv_epi8(
+                            _mm256_set1_epi32(INT_MIN), v, lane_mask));
+        }
+
+        agg->n += __builtin_popcount(lanes);
+        agg->count_if += __builtin_popcount(
+                            vect_range_mask(v, lo_vect, hi_vect) & lanes);
+    }
+
+    // Only 4 and 8 lanes left to reduce
+    _mm256_store_si256((__m256i*) sums, sum_vect);
+    _mm256_store_si256((__m256i*) mins, min_vect);
+    _mm256_store_si256((__m256i*) maxs, max_vect);
+
+    agg->sum = sums[0] + sums[1] + sums[2] + sums[3];
+    agg->min = INT_MAX;
+    agg->max = INT_MIN;
+    for(j = 0; j < 8; j++){
+        agg->min = min(agg->min, mins[j]);
+        agg->max = max(agg->max, maxs[j]);
+    }
+}
+
+void merge_aggregates(struct aggregate *agg, const struct aggregate *other){
+    agg->n += other->n;
+    agg->sum += other->sum;
+    agg->min = min(agg->min, other->min);
+    agg->max = max(agg->max, other->max);
+    agg->count_if += other->count_if;
+}
+
+int find_pattern(int *U, int i_start, int i_end, int *pattern, int m,
+                 int **ind_val){
+    int i, j;
+    int c = 0;
+
+    (*ind_val) = NULL;
+
+    // Let's slide the pattern along U, one position at a time
+    for(i = i_start; i <= i_end - m; i++){
+        for(j = 0; j < m && U[i + j] == pattern[j]; j++);
+        if(j == m){
+            add_j(i)
+        }
+    }
+
+    return c;
+}
+
+/**
+ * Whether the m values from U + i are those of pattern, compared 8 at a time
+ * (masked loads for the last ones, so that nothing past them is read).
+ */
+static int pattern_at(int *U, int i, int *pattern, int m){
+    int k;
+    unsigned int lanes;
+    struct vect_stride st;
+
+    vect_stride_init(&st, 1);
+
+    for(k = 0; k < m; k += 8){
+        lanes = (k + 8 <= m) ? 0xFF : vect_lanes(0, m - k);
+        if((vect_eq_mask(vect_load_lanes(&st, U, i + k, lanes),
+                         vect_load_lanes(&st, pattern, k, lanes)) & lanes)
+                != lanes)
+            return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * The occurences of pattern starting at U[i..i+7] (only the lanes set in
+ * lanes), as an 8 bits mask.
+ */
+VECT_INLINE unsigned int pattern_mask(int *U, int i, unsigned int lanes,
+                                      __m256i first_vect, __m256i last_vect,
+                                      int *pattern, int m){
+    unsigned int mask, candidates;
+    struct vect_stride st;
+
+    if(lanes == 0xFF)
+        candidates = vect_eq_mask(_mm256_loadu_si256((__m256i*)(U + i)),
+                                  first_vect) &
+                     vect_eq_mask(_mm256_loadu_si256((__m256i*)(U + i + m - 1)),
+                                  last_vect);
+    else {
+        vect_stride_init(&st, 1);
+        candidates = vect_eq_mask(vect_load_lanes(&st, U, i, lanes),
+                                  first_vect) &
+                     vect_eq_mask(vect_load_lanes(&st, U, i + m - 1, lanes),
+                                  last_vect) & lanes;
+    }
+
+    // The first and last values already match, patterns of one or two values
+    // don't need anything more
+    if(m <= 2)
+        return candidates;
+
+    mask = 0;
+    while(candidates){
+        if(pattern_at(U, i + __builtin_ctz(candidates), pattern, m))
+            mask |= candidates & -candidates;
+        candidates &= candidates - 1;
+    }
+
+    return mask;
+}
+
+int vect_find_pattern(int *U, int i_start, int i_end, int *pattern, int m,
+                      int **ind_val){
+    int i, i_last, size;
+    int c = 0;
+    unsigned int mask;
+
+    __m256i first_vect __attribute__ ((aligned(32))),
+            last_vect  __attribute__ ((aligned(32)));
+
+    first_vect = _mm256_set1_epi32(pattern[0]);
+    last_vect = _mm256_set1_epi32(pattern[m - 1]);
+
+    size = COMPRESS_INITIAL_SIZE;
+    (*ind_val) = malloc(size * sizeof(int));
+
+    // The occurences start in [i_start, i_last), and the loads of a block
+    // never go further than U[i_last + m - 2], the last element of the range
+    i_last = i_end - m + 1;
+    for(i = i_start; i < i_last; i += 8){
+        mask = pattern_mask(U, i, (i + 8 <= i_last) ? 0xFF :
+                                        vect_lanes(0, i_last - i),
+                            first_vect, last_vect, pattern, m);
+
+        while(mask){
+            append_index(ind_val, &size, c++, i + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+
+    (*ind_val) = realloc((*ind_val), max(c, 1) * sizeof(int));
+
+    return c;
+}
+
+int vect_count_pattern(int *U, int i_start, int i_end, int *pattern, int m){
+    int i, i_last;
+    int c = 0;
+
+    __m256i first_vect __attribute__ ((aligned(32))),
+            last_vect  __attribute__ ((aligned(32)));
+
+    first_vect = _mm256_set1_epi32(pattern[0]);
+    last_vect = _mm256_set1_epi32(pattern[m - 1]);
+
+    i_last = i_end - m + 1;
+    for(i = i_start; i < i_last; i += 8)
+        c += __builtin_popcount(pattern_mask(U, i, (i + 8 <= i_last) ? 0xFF :
+                                                    vect_lanes(0, i_last - i),
+                                             first_vect, last_vect, pattern,
+                                             m));
+
+    return c;
+}
+
+int vect_find_pattern_fill(int *U, int i_start, int i_end, int *pattern,
+                           int m, int *ind_val, int max_c){
+    int i, i_last;
+    int c = 0;
+    unsigned int mask;
+
+    __m256i first_vect __attribute__ ((aligned(32))),
+            last_vect  __attribute__ ((aligned(32)));
+
+    first_vect = _mm256_set1_epi32(pattern[0]);
+    last_vect = _mm256_set1_epi32(pattern[m - 1]);
+
+    i_last = i_end - m + 1;
+    for(i = i_start; i < i_last && c < max_c; i += 8){
+        mask = pattern_mask(U, i, (i + 8 <= i_last) ? 0xFF :
+                                        vect_lanes(0, i_last - i),
+                            first_vect, last_vect, pattern, m);
+
+        while(mask && c < max_c){
+            ind_val[c++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
     }
 
     return c;
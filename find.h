@@ -49,5 +49,145 @@ int find(int *U, int i_start, int i_end, int i_step, int val, int **ind_val);
 int vect_find(int *U, int i_start, int i_end, int i_step, int val,
               int **ind_val);
 
+/**
+ * Counts the occurences of val in U between the indexes i_start and i_end
+ * without storing their positions. It's the (fast) first pass of the two-pass
+ * version of thread_find: no memory is touched apart from U itself.
+ */
+int vect_count(int *U, int i_start, int i_end, int i_step, int val);
+
+/**
+ * Writes the positions of (at most max_c) occurences of val in U between the
+ * indexes i_start and i_end into ind_val, which must already have room for
+ * them. No allocation happens here, it's the second pass of the two-pass
+ * version of thread_find. Returns the number of positions written.
+ */
+int vect_find_fill(int *U, int i_start, int i_end, int i_step, int val,
+                   int *ind_val, int max_c);
+
+/**
+ * A branchless counterpart of vect_find for frequent values: instead of
+ * walking through the matching lanes of every block, their positions are
+ * packed at the beginning of a register with a single permute (looked up from
+ * the comparison mask) and all 8 lanes are stored after the c positions found
+ * so far, c then moving forward by the number of matches only. The result
+ * array grows geometrically instead of once per match.
+ */
+int vect_find_compress(int *U, int i_start, int i_end, int i_step, int val,
+                       int **ind_val);
+
+/**
+ * The same as vect_find_fill, using the packing of vect_find_compress. It
+ * never writes past ind_val[max_c - 1] so several threads can fill contiguous
+ * slices of the same array.
+ */
+int vect_find_compress_fill(int *U, int i_start, int i_end, int i_step,
+                            int val, int *ind_val, int max_c);
+
+/**
+ * The counterparts of vect_count and vect_find_fill for range predicates:
+ * they count (resp. write the positions of) the elements of U between the
+ * indexes i_start and i_end such that lo <= U[i] <= hi.
+ */
+int vect_count_range(int *U, int i_start, int i_end, int i_step, int lo,
+                     int hi);
+
+int vect_find_range_fill(int *U, int i_start, int i_end, int i_step, int lo,
+                         int hi, int *ind_val, int max_c);
+
+/**
+ * Writes the matches of val in U between the indexes i_start and i_end as a
+ * bitmap: bit j (bit j % 8 of byte j / 8) is set iff U[i_start + j * i_step]
+ * equals val, each block of 8 elements giving one byte of comparison mask.
+ * bitmap must be zeroed and have room for BITMAP_BYTES(n) bytes, n being the
+ * number of elements looked at. Returns the number of matches.
+ */
+#define BITMAP_BYTES(n) ((n) / 8 + 2)
+
+int vect_find_bitmap(int *U, int i_start, int i_end, int i_step, int val,
+                     unsigned char *bitmap);
+
+/**
+ * Counts the runs of consecutive matches of val (U[i], U[i + i_step], ... all
+ * equal to val) in U between the indexes i_start and i_end.
+ */
+int vect_count_runs(int *U, int i_start, int i_end, int i_step, int val);
+
+/**
+ * Writes (at most max_runs of) these runs into runs, as pairs of ints: the
+ * index of the first match of the run and the number of matches in it. Returns
+ * the number of matches covered by the runs written.
+ */
+int vect_find_runs_fill(int *U, int i_start, int i_end, int i_step, int val,
+                        int *runs, int max_runs);
+
+/**
+ * Counts the occurences of every value of [a, b] in U between the indexes
+ * i_start and i_end in a single pass: hist[v - a] is set to the number of
+ * occurences of v (the values outside of [a, b] are ignored), hist must have
+ * room for b - a + 1 ints.
+ *
+ * Two increments of the same counter in a row would have to wait for each
+ * other (the second load depends on the first store), which is what happens
+ * all the time with few distinct values. So the lanes of a block increment
+ * HISTOGRAM_COPIES different copies of the histogram, only summed up at the
+ * end.
+ */
+#define HISTOGRAM_COPIES 4
+
+void vect_histogram(int *U, int i_start, int i_end, int i_step, int a, int b,
+                    int *hist);
+
+/**
+ * What vect_aggregate computes over the elements of U it looks at: how many
+ * there are (n), their sum, their minimum and maximum, and how many of them
+ * satisfy lo <= U[i] <= hi (count_if). An empty range gives n = 0, sum = 0,
+ * min = INT_MAX and max = INT_MIN.
+ */
+struct aggregate{
+    int n;
+    long long sum;
+    int min;
+    int max;
+    int count_if;
+};
+
+void vect_aggregate(int *U, int i_start, int i_end, int i_step, int lo,
+                    int hi, struct aggregate *agg);
+
+/**
+ * Merges the aggregate of another part of U into agg.
+ */
+void merge_aggregates(struct aggregate *agg, const struct aggregate *other);
+
+/**
+ * Looks for the occurences of the m (>= 1) contiguous values of pattern in U
+ * between the indexes i_start and i_end: the positions i such that
+ * U[i + j] = pattern[j] for every j < m, the whole occurence lying in
+ * [i_start, i_end). Overlapping occurences are all found. Returns their
+ * number and puts their positions in *ind_val, like find does.
+ */
+int find_pattern(int *U, int i_start, int i_end, int *pattern, int m,
+                 int **ind_val);
+
+/**
+ * The vectorial counterpart of find_pattern: the first and the last values of
+ * pattern are broadcasted and compared to U[i..i+7] and U[i+m-1..i+m+6] (two
+ * shifted loads), the AND of both masks gives the 8 positions that may start
+ * an occurence and only these candidates get verified, 8 values at a time.
+ * The result array grows geometrically.
+ */
+int vect_find_pattern(int *U, int i_start, int i_end, int *pattern, int m,
+                      int **ind_val);
+
+/**
+ * The two passes of vect_find_pattern, as vect_count and vect_find_fill are
+ * those of vect_find.
+ */
+int vect_count_pattern(int *U, int i_start, int i_end, int *pattern, int m);
+
+int vect_find_pattern_fill(int *U, int i_start, int i_end, int *pattern,
+                           int m, int *ind_val, int max_c);
+
 
 #endif
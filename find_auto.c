@@ -0,0 +1,86 @@
+/*
+ * ============================================================================
+ *
+ *       Filename:  find_auto.c
+ *
+ *    Description:  Implementation of the selectivity estimation and of the
+ *                  kernel selection of find_auto.
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 06:01:23
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  agent (agent@local)
+ *
+ * ============================================================================
+ */
+#include "find_auto.h"
+
+#include <stdlib.h>
+
+#include "find.h"
+#include "utilities.h"
+
+float estimate_selectivity(int *U, int i_start, int i_end, int i_step,
+                           int val){
+    int n, b, start, c;
+
+    // The number of elements we'd actually look at
+    n = (i_end - i_start + i_step - 1) / i_step;
+
+    if(n <= 0)
+        return 0;
+
+    if(n <= FIND_AUTO_SAMPLE_BLOCKS * FIND_AUTO_SAMPLE_SIZE)
+        return (float) vect_count(U, i_start, i_end, i_step, val) / n;
+
+    // Let's spread our blocks evenly, the first one at the beginning of the
+    // search and the last one at its end, so that a change of density along
+    // the array doesn't go unnoticed
+    c = 0;
+    for(b = 0; b < FIND_AUTO_SAMPLE_BLOCKS; b++){
+        start = i_start + i_step * (int)((long) b * (n - FIND_AUTO_SAMPLE_SIZE)
+                                         / (FIND_AUTO_SAMPLE_BLOCKS - 1));
+        c += vect_count(U, start,
+                        min(start + FIND_AUTO_SAMPLE_SIZE * i_step, i_end),
+                        i_step, val);
+    }
+
+    return (float) c / (FIND_AUTO_SAMPLE_BLOCKS * FIND_AUTO_SAMPLE_SIZE);
+}
+
+int choose_find_strategy(int n, float selectivity){
+    if(n <= FIND_AUTO_SCALAR_MAX_N)
+        return FIND_STRATEGY_SCALAR;
+    if(selectivity < FIND_AUTO_SKIP_MAX_SELECTIVITY)
+        return FIND_STRATEGY_SKIP;
+    if(selectivity < FIND_AUTO_COMPRESS_MIN_SELECTIVITY)
+        return FIND_STRATEGY_TWO_PASS;
+    return FIND_STRATEGY_COMPRESS;
+}
+
+int find_auto(int *U, int i_start, int i_end, int i_step, int val,
+              int **ind_val){
+    int n, c;
+
+    n = (i_end - i_start + i_step - 1) / i_step;
+
+    // No need to sample anything for the tiny searches
+    if(n <= FIND_AUTO_SCALAR_MAX_N)
+        return find(U, i_start, i_end, i_step, val, ind_val);
+
+    switch(choose_find_strategy(n, estimate_selectivity(U, i_start, i_end,
+                                                        i_step, val))){
+        case FIND_STRATEGY_SKIP:
+            return vect_find(U, i_start, i_end, i_step, val, ind_val);
+        case FIND_STRATEGY_TWO_PASS:
+            c = vect_count(U, i_start, i_end, i_step, val);
+            (*ind_val) = malloc(sizeof(int) * c);
+            return vect_find_fill(U, i_start, i_end, i_step, val, *ind_val, c);
+        case FIND_STRATEGY_COMPRESS:
+            return vect_find_compress(U, i_start, i_end, i_step, val, ind_val);
+        default:
+            return find(U, i_start, i_end, i_step, val, ind_val);
+    }
+}
@@ -0,0 +1,73 @@
+/*
+ * ============================================================================
+ *
+ *       Filename:  find_auto.h
+ *
+ *    Description:  Picking the best find kernel for a given search from an
+ *                  estimation of the proportion of matches (the selectivity).
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 06:01:23
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  agent (agent@local)
+ *
+ * ============================================================================
+ */
+
+#ifndef _FIND_AUTO_H_
+#define _FIND_AUTO_H_
+
+// The strategies find_auto chooses from:
+//  - FIND_STRATEGY_SCALAR: find, for tiny searches
+//  - FIND_STRATEGY_SKIP: vect_find, which skips the blocks without any match,
+//    best when val is rare
+//  - FIND_STRATEGY_TWO_PASS: vect_count then vect_find_fill into an array of
+//    the exact size, no realloc at all
+//  - FIND_STRATEGY_COMPRESS: vect_find_compress, branchless, best when val is
+//    frequent
+#define FIND_STRATEGY_SCALAR    0
+#define FIND_STRATEGY_SKIP      1
+#define FIND_STRATEGY_TWO_PASS  2
+#define FIND_STRATEGY_COMPRESS  3
+
+// Below that many elements, the scalar find is as good as anything else
+#define FIND_AUTO_SCALAR_MAX_N              64
+
+// The selectivity is estimated on that many blocks of that many elements
+// spread over the whole search
+#define FIND_AUTO_SAMPLE_BLOCKS             16
+#define FIND_AUTO_SAMPLE_SIZE               256
+
+// Below 2% of matches, most blocks of 8 are empty and skipping them wins.
+// Above 5%, there's a match in a third of the blocks and not branching on
+// them wins. In between, counting first saves all the reallocs. These are
+// initial guesses, not measurements: the crossovers still have to be read
+// off the kernels suite of make bench (vect_find against vect_find_compress
+// over the hit rates) on the machines we care about.
+#define FIND_AUTO_SKIP_MAX_SELECTIVITY      0.02f
+#define FIND_AUTO_COMPRESS_MIN_SELECTIVITY  0.05f
+
+/**
+ * Estimates the proportion of the elements of U between i_start and i_end
+ * (with a step of i_step) that are equal to val by counting the matches in a
+ * few evenly spread blocks. Small searches are counted exactly.
+ */
+float estimate_selectivity(int *U, int i_start, int i_end, int i_step,
+                           int val);
+
+/**
+ * Returns the FIND_STRATEGY_* to use to look for a value in n elements, given
+ * the proportion of them it's expected to match.
+ */
+int choose_find_strategy(int n, float selectivity);
+
+/**
+ * The same as find, using the strategy that suits the estimated selectivity
+ * of val.
+ */
+int find_auto(int *U, int i_start, int i_end, int i_step, int val,
+              int **ind_val);
+
+#endif
@@ -0,0 +1,324 @@
+/*
+ * ============================================================================
+ *
+ *       Filename:  loadgen.c
+ *
+ *    Description:  simdload, a local load generator for simdsrv: it maps the
+ *                  shared memory segment of the server to learn about U, then
+ *                  opens several connections sending random queries one after
+ *                  the other and reports the throughput (queries per second)
+ *                  and latency percentiles.
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 06:04:11
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  agent (agent@local)
+ *
+ * ============================================================================
+ */
+
+#define _XOPEN_SOURCE 600
+
+// Standard library
+#include <argp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Unix-specific standard library
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Project
+#include "colors.h"
+#include "query.h"
+#include "utilities.h"
+
+struct load_arguments{
+    int connections;
+    int queries;
+    int op;
+    char *socket_path;
+    char *shm_name;
+};
+
+struct connection_data{
+    struct load_arguments *arguments;
+    struct query_shm_header header;
+    unsigned int seed;
+    // The latency of every query answered on that connection, in ns
+    long *latencies;
+    int answered;
+    // The total number of positions received and of failed queries
+    long received;
+    int failures;
+};
+
+//-----------------------------------------------------------------------------
+// CLI arguments
+//-----------------------------------------------------------------------------
+static char doc[] = "Sends random queries to simdsrv over several connections "
+                    "and reports the throughput and latency percentiles.";
+static char args_doc[] = "";
+static struct argp_option options[] = {
+    { "connections", 'c', "COUNT", 0, "The number of concurrent connections "
+        "(default: 8)."},
+    { "queries", 'q', "COUNT", 0, "The number of queries sent on every "
+        "connection (default: 100)."},
+    { "op", 'o', "OP", 0, "The queries to send: find, count, range or mix "
+        "(default: count)."},
+    { "socket", 's', "PATH", 0, "The path of the Unix domain socket "
+        "(default: " QUERY_DEFAULT_SOCKET ")."},
+    { "shm", 'S', "NAME", 0, "The name of the shared memory segment "
+        "(default: " QUERY_DEFAULT_SHM ")."},
+    { 0 }
+};
+
+// Stands for a random mix of the three kinds of queries
+#define OP_MIX -1
+
+static error_t parse_opt(int key, char *arg, struct argp_state *state){
+    struct load_arguments *arguments = state->input;
+    switch (key) {
+        case 'c': arguments->connections = max(atoi(arg), 1); break;
+        case 'q': arguments->queries = max(atoi(arg), 1); break;
+        case 'o':
+            if(!strcmp(arg, "find"))
+                arguments->op = QUERY_FIND;
+            else if(!strcmp(arg, "count"))
+                arguments->op = QUERY_COUNT;
+            else if(!strcmp(arg, "range"))
+                arguments->op = QUERY_RANGE;
+            else if(!strcmp(arg, "mix"))
+                arguments->op = OP_MIX;
+            else
+                argp_error(state, "unknown query type: %s", arg);
+            break;
+        case 's': arguments->socket_path = arg; break;
+        case 'S': arguments->shm_name = arg; break;
+        case ARGP_KEY_ARG: return 0;
+        default: return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+static struct argp argp = { options, parse_opt, args_doc, doc };
+
+//-----------------------------------------------------------------------------
+// The load
+//-----------------------------------------------------------------------------
+
+/**
+ * Maps the shared memory segment of the server just long enough to copy its
+ * header. Returns -1 if there's no server (or if it isn't ready yet).
+ */
+static int read_shm_header(const char *name, struct query_shm_header *header){
+    int fd;
+    struct query_shm_header *shm;
+
+    fd = shm_open(name, O_RDONLY, 0);
+    if(fd < 0){
+        perror("shm_open");
+        return -1;
+    }
+
+    shm = mmap(NULL, QUERY_SHM_DATA_OFFSET, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(shm == MAP_FAILED){
+        perror("mmap");
+        return -1;
+    }
+
+    *header = *shm;
+    munmap(shm, QUERY_SHM_DATA_OFFSET);
+
+    return header->n > 0 ? 0 : -1;
+}
+
+static int connect_to_server(const char *path){
+    int fd;
+    struct sockaddr_un addr;
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0)
+        return -1;
+
+    memset(&addr, 0, sizeof(struct sockaddr_un));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    if(connect(fd, (struct sockaddr*) &addr, sizeof(struct sockaddr_un)) < 0){
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+void* run_connection(void *args){
+    int fd, q, capacity;
+    int *positions;
+    struct connection_data *data;
+    struct load_arguments *arguments;
+    struct query_request req;
+    struct query_response res;
+    struct timespec t0, t1;
+
+    data = (struct connection_data*) args;
+    arguments = data->arguments;
+
+    fd = connect_to_server(arguments->socket_path);
+    if(fd < 0){
+        data->failures = arguments->queries;
+        data->answered = 0;
+        pthread_exit(NULL);
+    }
+
+    capacity = 1024;
+    positions = malloc(capacity * sizeof(int));
+
+    for(q = 0; q < arguments->queries; q++){
+        req.op = (arguments->op == OP_MIX) ? rand_r(&data->seed) % 3
+                                           : arguments->op;
+        req.i_start = 0;
+        req.i_end = data->header.n;
+        req.lo = data->header.a + rand_r(&data->seed) %
+                                  (data->header.b - data->header.a + 1);
+        // Ranges of a tenth of [a, b]
+        req.hi = req.lo + (data->header.b - data->header.a) / 10;
+
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+
+        if(write_full(fd, &req, sizeof(struct query_request)) < 0 ||
+           read_full(fd, &res, sizeof(struct query_response)) < 0)
+            break;
+
+        if(res.status == QUERY_OK && req.op != QUERY_COUNT){
+            if(res.count > capacity){
+                capacity = res.count;
+                positions = realloc(positions, capacity * sizeof(int));
+            }
+            if(read_full(fd, positions, res.count * sizeof(int)) < 0)
+                break;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+
+        data->latencies[q] = tdiff_nanos(t0, t1);
+        data->received += res.count;
+        data->failures += (res.status != QUERY_OK);
+    }
+
+    // The queries we couldn't send at all
+    data->answered = q;
+    data->failures += arguments->queries - q;
+
+    free(positions);
+    close(fd);
+
+    pthread_exit(NULL);
+}
+
+static int cmp_long(const void *a, const void *b){
+    long x = *(const long*) a, y = *(const long*) b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv){
+    int i, j, failures, total;
+    long received;
+    long *latencies;
+    struct load_arguments arguments;
+    struct query_shm_header header;
+    struct connection_data *data;
+    pthread_t *threads;
+    struct timespec t0, t1;
+    double wall;
+
+    arguments.connections = 8;
+    arguments.queries = 100;
+    arguments.op = QUERY_COUNT;
+    arguments.socket_path = QUERY_DEFAULT_SOCKET;
+    arguments.shm_name = QUERY_DEFAULT_SHM;
+
+    argp_parse(&argp, argc, argv, 0, 0, &arguments);
+
+    if(read_shm_header(arguments.shm_name, &header) < 0){
+        fprintf(stderr, "No simdsrv ready behind %s\n", arguments.shm_name);
+        return 1;
+    }
+
+    threads = malloc(arguments.connections * sizeof(pthread_t));
+    data = malloc(arguments.connections * sizeof(struct connection_data));
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    for(i = 0; i < arguments.connections; i++){
+        data[i].arguments = &arguments;
+        data[i].header = header;
+        data[i].seed = 42 + i;
+        data[i].latencies = malloc(arguments.queries * sizeof(long));
+        data[i].received = 0;
+        data[i].failures = 0;
+        pthread_create(&threads[i], NULL, run_connection, (void*) &data[i]);
+    }
+
+    for(i = 0; i < arguments.connections; i++)
+        pthread_join(threads[i], NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    wall = tdiff_nanos(t0, t1) / 1e9;
+
+    // All the successful latencies together
+    latencies = malloc(arguments.connections * arguments.queries *
+                       sizeof(long));
+    total = 0;
+    failures = 0;
+    received = 0;
+    for(i = 0; i < arguments.connections; i++){
+        for(j = 0; j < data[i].answered; j++)
+            latencies[total++] = data[i].latencies[j];
+        failures += data[i].failures;
+        received += data[i].received;
+        free(data[i].latencies);
+    }
+
+    qsort(latencies, total, sizeof(long), &cmp_long);
+
+    printf(ANSI_STYLE_BOLD "  [*] %d queries over %d connections on %d "
+           "elements\n" ANSI_STYLE_NO_BOLD, total, arguments.connections,
+           header.n);
+    if(total > 0)
+        printf("        * throughput:  " ANSI_STYLE_BOLD "%.1f queries/s"
+               ANSI_STYLE_NO_BOLD "\n"
+               "        * latency:     p50 %.1f µs, p90 %.1f µs, p99 %.1f µs, "
+               "max %.1f µs\n"
+               "        * positions:   %.1f per query\n", total / wall,
+               latencies[total / 2] / 1e3, latencies[total * 9 / 10] / 1e3,
+               latencies[total * 99 / 100] / 1e3, latencies[total - 1] / 1e3,
+               (double) received / total);
+    if(failures > 0)
+        printf("        * " ANSI_COLOR_RED "%d queries failed" ANSI_COLOR_RESET
+               "\n", failures);
+
+    // And the same thing for scripts
+    printf("\n%d %f %ld %ld %ld %ld %d\n", total, total / wall,
+           total ? latencies[total / 2] : 0,
+           total ? latencies[total * 9 / 10] : 0,
+           total ? latencies[total * 99 / 100] : 0,
+           total ? latencies[total - 1] : 0, failures);
+
+    free(latencies);
+    free(data);
+    free(threads);
+
+    return failures > 0;
+}
@@ -23,29 +23,308 @@
 #define _XOPEN_SOURCE 600
 
 // Standard library
+#include <malloc.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
 // Unix-specific standard library
+#include <sys/resource.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 // Project
 #include "colors.h"
 #include "cli_arguments.h"
 #include "find.h"
+#include "result.h"
 #include "thread_find.h"
+#include "trace.h"
 #include "utilities.h"
 
+// What it takes to get the matches of a search in a given representation
+struct repr_measure{
+    int repr;
+    long micros;
+    long bytes;
+    long peak_kb;
+    int ok;
+};
+
+static const char *repr_names[] = {"indexes", "bitmap", "runs", "auto"};
+
+// The sizes of a sweep grow from SWEEP_MIN_N to n by a factor of 10^(1/20),
+// i.e. 20 of them per power of ten
+#define SWEEP_MIN_N         1000
+#define SWEEP_GROWTH        1.1220184543019633
+
+// The smaller prefixes get searched several times in a row (keeping the
+// fastest run) so that every point covers at least that many elements
+#define SWEEP_MIN_ELEMENTS  (1 << 22)
+
+// Every kernel of a sweep gets called through that same signature
+typedef int (*sweep_kernel_fn)(int *U, int i_start, int i_end, int i_step,
+                               int val, int **ind_val);
+
+struct sweep_kernel{
+    const char *name;
+    sweep_kernel_fn fn;
+    // Whether it runs once per thread count
+    int threaded;
+};
+
+/**
+ * Reads a field of /proc/self/status, in KB (-1 if it isn't there).
+ */
+static long read_status_kb(const char *field){
+    FILE *status;
+    char line[256];
+    long kb = -1;
+
+    status = fopen("/proc/self/status", "r");
+    if(status == NULL)
+        return -1;
+
+    while(fgets(line, sizeof(line), status) != NULL){
+        if(!strncmp(line, field, strlen(field)))
+            kb = atol(line + strlen(field));
+    }
+
+    fclose(status);
+
+    return kb;
+}
+
+/**
+ * Resets the peak RSS of the process to its current RSS (VmHWM = VmRSS), which
+ * Linux lets us do since 4.0. Returns -1 if it couldn't.
+ */
+static int reset_peak_rss(){
+    FILE *clear_refs;
+
+    clear_refs = fopen("/proc/self/clear_refs", "w");
+    if(clear_refs == NULL)
+        return -1;
+
+    fputs("5", clear_refs);
+
+    return fclose(clear_refs);
+}
+
+/**
+ * Looks for val in U in the repr representation in a child process, so that
+ * the growth of its peak RSS is only due to that search, and checks its
+ * matches against the c expected ones. Returns -1 if the child couldn't be
+ * run.
+ */
+static int measure_result_repr(int *U, int n, int val, int repr,
+                               int *expected, int c, struct repr_measure *m){
+    int fd[2], i, k, status;
+    long base_kb, hwm_kb;
+    pid_t pid;
+    struct find_result res;
+    struct result_iter it;
+    struct rusage usage;
+    struct timespec t0, t1;
+
+    if(pipe(fd) < 0)
+        return -1;
+
+    pid = fork();
+    if(pid < 0){
+        close(fd[0]);
+        close(fd[1]);
+        return -1;
+    }
+
+    if(pid == 0){
+        close(fd[0]);
+
+        // The child starts with our whole RSS, and with the peak we reached
+        // earlier on. Let's give back the freed memory of our heap (which a
+        // malloc would otherwise reuse without any new page) and start
+        // measuring from the current RSS. Without /proc, getrusage still
+        // gives a peak but it may well be our own one.
+        malloc_trim(0);
+        if(reset_peak_rss() == 0)
+            base_kb = read_status_kb("VmRSS:");
+        else {
+            getrusage(RUSAGE_SELF, &usage);
+            base_kb = usage.ru_maxrss;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        find_result(U, 0, n, 1, val, repr, &res);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+
+        m->repr = res.repr;
+        m->micros = tdiff_micros(t0, t1);
+        m->bytes = result_bytes(&res);
+
+        // Let's walk through the matches, whatever their representation
+        m->ok = (res.count == c);
+        k = 0;
+        result_iter_init(&it, &res);
+        while(m->ok && result_iter_next(&it, &i))
+            m->ok = (k < c && expected[k++] == i);
+
+        hwm_kb = read_status_kb("VmHWM:");
+        if(hwm_kb < 0){
+            getrusage(RUSAGE_SELF, &usage);
+            hwm_kb = usage.ru_maxrss;
+        }
+        m->peak_kb = hwm_kb - base_kb;
+
+        result_free(&res);
+        write_full(fd[1], m, sizeof(struct repr_measure));
+        _exit(0);
+    }
+
+    close(fd[1]);
+    k = read_full(fd[0], m, sizeof(struct repr_measure));
+    close(fd[0]);
+    waitpid(pid, &status, 0);
+
+    return k;
+}
+
+static int sweep_thread_find_scalar(int *U, int i_start, int i_end,
+                                    int i_step, int val, int **ind_val){
+    return thread_find(U, i_start, i_end, i_step, val, ind_val, -1,
+                       THREAD_FIND_SCALAR);
+}
+
+static int sweep_thread_find_vect(int *U, int i_start, int i_end, int i_step,
+                                  int val, int **ind_val){
+    return thread_find(U, i_start, i_end, i_step, val, ind_val, -1,
+                       THREAD_FIND_VECT);
+}
+
+static int sweep_thread_find_two_pass(int *U, int i_start, int i_end,
+                                      int i_step, int val, int **ind_val){
+    return thread_find(U, i_start, i_end, i_step, val, ind_val, -1,
+                       THREAD_FIND_TWO_PASS);
+}
+
+static int sweep_thread_find_auto(int *U, int i_start, int i_end, int i_step,
+                                  int val, int **ind_val){
+    return thread_find(U, i_start, i_end, i_step, val, ind_val, -1,
+                       THREAD_FIND_AUTO);
+}
+
+static struct sweep_kernel sweep_kernels[] = {
+    { "find",                   &find,                          0 },
+    { "vect_find",              &vect_find,                     0 },
+    { "thread_find_scalar",     &sweep_thread_find_scalar,      1 },
+    { "thread_find_vect",       &sweep_thread_find_vect,        1 },
+    { "thread_find_two_pass",   &sweep_thread_find_two_pass,    1 },
+    { "thread_find_auto",       &sweep_thread_find_auto,        1 },
+};
+
+/**
+ * Runs every kernel over the prefixes of U of growing sizes (up to n) with
+ * every thread count, and prints one CSV row per kernel, size and thread
+ * count: the array only gets generated once for the whole sweep. Returns 19
+ * if a kernel doesn't find the same matches as find does, 0 otherwise.
+ */
+static int run_sweep(int *U, int n, int val, int *thread_counts,
+                     int n_thread_counts){
+    int size, kn, t, r, reps, c, expected;
+    int *ind_val, *expected_ind_val;
+    long ns, best_ns;
+    double next_size;
+    struct sweep_kernel *kernel;
+    struct timespec t0, t1;
+
+    printf(ANSI_STYLE_BOLD
+"  [*] Sweeping the sizes from %d to %d, one CSV row per point:"
+    ANSI_STYLE_NO_BOLD " \n\n", min(SWEEP_MIN_N, n), n);
+    printf("kernel,n,threads,reps,ns,matches\n");
+
+    next_size = SWEEP_MIN_N;
+    for(size = min(SWEEP_MIN_N, n); size <= n; ){
+        expected = find(U, 0, size, 1, val, &expected_ind_val);
+
+        reps = max(1, SWEEP_MIN_ELEMENTS / size);
+
+        for(kn = 0; kn < (int)(sizeof(sweep_kernels)/
+                               sizeof(struct sweep_kernel)); kn++){
+            kernel = &sweep_kernels[kn];
+
+            for(t = 0; t < (kernel->threaded ? n_thread_counts : 1); t++){
+                set_number_of_threads(kernel->threaded ? thread_counts[t] : 1);
+
+                best_ns = -1;
+                for(r = 0; r < reps; r++){
+                    clock_gettime(CLOCK_MONOTONIC, &t0);
+                    c = kernel->fn(U, 0, size, 1, val, &ind_val);
+                    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+                    // Same matches, at the same positions
+                    if(c != expected){
+                        fprintf(stderr, "%s found %d matches instead of %d "
+                                "for n = %d! Stopping...\n", kernel->name, c,
+                                expected, size);
+                        free(ind_val);
+                        free(expected_ind_val);
+                        return 19;
+                    }
+                    if(c > 0 && memcmp(ind_val, expected_ind_val,
+                                       c * sizeof(int)) != 0){
+                        fprintf(stderr, "%s didn't return the positions find "
+                                "does for n = %d! Stopping...\n",
+                                kernel->name, size);
+                        free(ind_val);
+                        free(expected_ind_val);
+                        return 19;
+                    }
+                    free(ind_val);
+
+                    ns = tdiff_nanos(t0, t1);
+                    if(best_ns < 0 || ns < best_ns)
+                        best_ns = ns;
+                }
+
+                printf("%s,%d,%d,%d,%ld,%d\n", kernel->name, size,
+                       kernel->threaded ? thread_counts[t] : 1, reps, best_ns,
+                       expected);
+            }
+        }
+        fflush(stdout);
+        free(expected_ind_val);
+
+        // On to the next size of the grid, the last point being n itself
+        if(size == n)
+            break;
+        while((int) next_size <= size)
+            next_size *= SWEEP_GROWTH;
+        size = min((int) next_size, n);
+    }
+
+    return 0;
+}
 
 int main(int argc, char **argv){
-    struct timespec t0, t1, t2, t3, t4, t5, t6, t7;
-    long d1, d2, d3, d4;
-    int n, a, b, i, lookup_value, k, c1, c2, c3, c4, c5, c6, eq;
-    float p_vect, p_parrallel, p_parrallel_vect, p_vect_bis;
-    int *ind_val1, *ind_val2, *ind_val3, *ind_val4, *ind_val5, *ind_val6;
+    struct timespec t0, t1, t2, t3, t4, t5, t6, t7, t8, t9;
+    long d1, d2, d3, d4, d5;
+    int n, a, b, i, l, lookup_value, k, c1, c2, c3, c4, c5, c6, c7, c8, eq;
+    float p_vect, p_parrallel, p_parrallel_vect, p_vect_bis, p_two_pass;
+    int *ind_val1, *ind_val2, *ind_val3, *ind_val4, *ind_val5, *ind_val6,
+        *ind_val7, *ind_val8;
+    int steps[] = {2, 3, 4, 8, 16};
+    int pattern_lengths[] = {2, 4, 8, 16}, m;
+    int step, s_c1, s_c2, s_c3, *s_ind_val1, *s_ind_val2, *s_ind_val3;
+    long s_d1, s_d2, s_d3;
+    int *hist1, *hist2, *hist3, width, h_min, h_max, h_count_if;
+    long long h_sum;
+    long h_d1, h_d2, h_d3, h_d4;
+    struct aggregate agg;
+    struct repr_measure rm;
+    int repr;
+    char repr_name[32];
     int* test_array;
+    int sweep, thread_counts[MAX_THREAD_COUNTS], n_thread_counts;
     struct arguments *arguments;
 
     printf("\n" ANSI_COLOR_MAGENTA
@@ -70,6 +349,10 @@ ANSI_COLOR_MAGENTA
     b = arguments->b;
     k = arguments->k;
     lookup_value = arguments->f;
+    sweep = arguments->sweep;
+    n_thread_counts = arguments->n_thread_counts;
+    memcpy(thread_counts, arguments->thread_counts,
+           n_thread_counts * sizeof(int));
 
     free(arguments);
     //-------------------------------------------------------------------------
@@ -91,6 +374,11 @@ ANSI_COLOR_MAGENTA
 "                            -- Done ! -- \n\n" ANSI_STYLE_NO_BOLD
     ANSI_COLOR_RESET);
 
+    // All the prefixes of that same array instead of the tables below
+    if(sweep)
+        return run_sweep(test_array, n, lookup_value, thread_counts,
+                         n_thread_counts);
+
     printf( ANSI_STYLE_BOLD
 "  [*] Looking for element " ANSI_COLOR_GREEN "%d" ANSI_COLOR_RESET
 ANSI_STYLE_BOLD            " using different implementations of find: \n\n"
@@ -133,7 +421,8 @@ ANSI_STYLE_BOLD            " using different implementations of find: \n\n"
     ((float)d1)/d2);
 
     clock_gettime(CLOCK_MONOTONIC, &t4);
-    c3 = thread_find(test_array, 0, n, 1, lookup_value, &ind_val3, -1, 0);
+    c3 = thread_find(test_array, 0, n, 1, lookup_value, &ind_val3, -1,
+                     THREAD_FIND_SCALAR);
     clock_gettime(CLOCK_MONOTONIC, &t5);
     d3 = tdiff_micros(t4, t5);
     printf(
@@ -148,7 +437,8 @@ ANSI_STYLE_BOLD            " using different implementations of find: \n\n"
     ((float)d1)/d3);
 
     clock_gettime(CLOCK_MONOTONIC, &t6);
-    c4 = thread_find(test_array, 0, n, 1, lookup_value, &ind_val4, -1, 1);
+    c4 = thread_find(test_array, 0, n, 1, lookup_value, &ind_val4, -1,
+                     THREAD_FIND_VECT);
     clock_gettime(CLOCK_MONOTONIC, &t7);
     d4 = tdiff_micros(t6, t7);
     printf(
@@ -159,9 +449,25 @@ ANSI_STYLE_BOLD            " using different implementations of find: \n\n"
                                              " |       "
                      ANSI_STYLE_BOLD ANSI_COLOR_GREEN "x%5.2f"
                         ANSI_STYLE_NO_BOLD ANSI_COLOR_RESET "       |\n"
+"     |                         |              |                    | \n",
+    d4, ((float)d1)/d4);
+
+    clock_gettime(CLOCK_MONOTONIC, &t8);
+    c7 = thread_find(test_array, 0, n, 1, lookup_value, &ind_val7, -1,
+                     THREAD_FIND_TWO_PASS);
+    clock_gettime(CLOCK_MONOTONIC, &t9);
+    d5 = tdiff_micros(t8, t9);
+    printf(
+"     |" ANSI_STYLE_BOLD
+           " thread_find() (2-pass)  " ANSI_STYLE_NO_BOLD
+                          "| "ANSI_STYLE_BOLD ANSI_COLOR_YELLOW
+                                 "%9ld ms" ANSI_STYLE_NO_BOLD ANSI_COLOR_RESET
+                                             " |       "
+                     ANSI_STYLE_BOLD ANSI_COLOR_YELLOW "x%5.2f"
+                        ANSI_STYLE_NO_BOLD ANSI_COLOR_RESET "       |\n"
 "     |                         |              |                    | \n"
 "     *-------------------------*--------------*--------------------* \n\n",
-    d4, ((float)d1)/d4);
+    d5, ((float)d1)/d5);
 
 
     //-------------------------------------------------------------------------
@@ -172,19 +478,20 @@ ANSI_STYLE_BOLD            " using different implementations of find: \n\n"
 "  [*] Testing the correctness of all our implementations: \n"
     ANSI_STYLE_NO_BOLD );
 
-    if(c1 == c2 && c1 == c3 && c1 == c4)
+    if(c1 == c2 && c1 == c3 && c1 == c4 && c1 == c7)
         printf("       - The ind_val arrays all have the " ANSI_COLOR_GREEN
                 ANSI_STYLE_BOLD "same size" ANSI_COLOR_RESET
                 ANSI_STYLE_NO_BOLD".\n");
     else {
         printf("       - The ind_val arrays" ANSI_COLOR_RED ANSI_STYLE_BOLD
                " don't have the same size" ANSI_COLOR_RESET ANSI_STYLE_NO_BOLD
-               " (%d %d %d %d)! Stopping...\n", c1, c2, c3, c4);
+               " (%d %d %d %d %d)! Stopping...\n", c1, c2, c3, c4, c7);
 
         free(ind_val1);
         free(ind_val2);
         free(ind_val3);
         free(ind_val4);
+        free(ind_val7);
 
         return 12;
     }
@@ -194,7 +501,7 @@ ANSI_STYLE_BOLD            " using different implementations of find: \n\n"
 
     for(i = 0; i < c1; i++)
         eq = eq && (ind_val1[i] == ind_val2[i] && ind_val1[i] == ind_val3[i])
-                && (ind_val1[i] == ind_val4[i]);
+                && (ind_val1[i] == ind_val4[i] && ind_val1[i] == ind_val7[i]);
 
     if(eq)
         printf("       - All have the " ANSI_COLOR_GREEN ANSI_STYLE_BOLD
@@ -208,6 +515,7 @@ ANSI_STYLE_BOLD            " using different implementations of find: \n\n"
         free(ind_val2);
         free(ind_val3);
         free(ind_val4);
+        free(ind_val7);
 
         return 13;
     }
@@ -215,13 +523,25 @@ ANSI_STYLE_BOLD            " using different implementations of find: \n\n"
 
     // Let's make sure our k-factor works as expected
     if(k >= 0){
-        c5 = thread_find(test_array, 0, n, 1, lookup_value, &ind_val5, k, 0);
-        c6 = thread_find(test_array, 0, n, 1, lookup_value, &ind_val6, k, 1);
+        c5 = thread_find(test_array, 0, n, 1, lookup_value, &ind_val5, k,
+                         THREAD_FIND_SCALAR);
+        c6 = thread_find(test_array, 0, n, 1, lookup_value, &ind_val6, k,
+                         THREAD_FIND_VECT);
+        c8 = thread_find(test_array, 0, n, 1, lookup_value, &ind_val8, k,
+                         THREAD_FIND_TWO_PASS);
+
+        // The two-pass version knows where every match goes before writing
+        // anything, so it must return exactly the k first occurences (all of
+        // them for k = 0, which thread_find takes as "no limit")
+        eq = (c8 == (k > 0 ? min(k, c1) : c1));
+        for(i = 0; eq && i < c8; i++)
+            eq = (ind_val8[i] == ind_val1[i]);
 
         free(ind_val5);
         free(ind_val6);
+        free(ind_val8);
 
-        if( (k == c5 || c5 == c1) && (k >= c6 || c6 == c1))
+        if( (k == c5 || c5 == c1) && (k >= c6 || c6 == c1) && eq)
             printf("       - " ANSI_COLOR_GREEN ANSI_STYLE_BOLD "The "
                    "k-factor works as expected" ANSI_COLOR_RESET
                    ANSI_STYLE_NO_BOLD", careful though, we have \n         "
@@ -231,17 +551,277 @@ ANSI_STYLE_BOLD            " using different implementations of find: \n\n"
             printf("       - " ANSI_COLOR_RED ANSI_STYLE_BOLD "The k-factor "
                    "doesn't behave as expected" ANSI_COLOR_RESET
                    ANSI_STYLE_NO_BOLD". \n           Debug info: k = %d, c5 = "
-                   "%d, c6 = %d\n           Exiting...\n", k, c5, c6);
+                   "%d, c6 = %d, c8 = %d\n           Exiting...\n", k, c5,
+                   c6, c8);
 
             free(ind_val1);
             free(ind_val2);
             free(ind_val3);
             free(ind_val4);
+            free(ind_val7);
 
             return 14;
         }
     }
 
+    //-------------------------------------------------------------------------
+    // Strided searches: only one field out of i_step (think of an array of
+    // structures) gets looked at. Throughputs are given in millions of
+    // elements actually compared per second.
+    //-------------------------------------------------------------------------
+    printf( ANSI_STYLE_BOLD
+"\n  [*] Strided searches (throughput in M elements/s): \n\n"
+    ANSI_STYLE_NO_BOLD);
+    printf(
+"     *--------*--------------*--------------*-----------------------* \n"
+"     | i_step |    find()    | vect_find()  | thread_find() (2-pass)| \n"
+"     *--------*--------------*--------------*-----------------------* \n");
+
+    for(i = 0; i < (int)(sizeof(steps)/sizeof(int)); i++){
+        step = steps[i];
+
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        s_c1 = find(test_array, 0, n, step, lookup_value, &s_ind_val1);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        s_c2 = vect_find(test_array, 0, n, step, lookup_value, &s_ind_val2);
+        clock_gettime(CLOCK_MONOTONIC, &t2);
+        s_c3 = thread_find(test_array, 0, n, step, lookup_value, &s_ind_val3,
+                           -1, THREAD_FIND_TWO_PASS);
+        clock_gettime(CLOCK_MONOTONIC, &t3);
+
+        // Let's not divide by zero on tiny arrays
+        s_d1 = max(tdiff_micros(t0, t1), 1);
+        s_d2 = max(tdiff_micros(t1, t2), 1);
+        s_d3 = max(tdiff_micros(t2, t3), 1);
+
+        eq = (s_c1 == s_c2 && s_c1 == s_c3);
+        for(l = 0; eq && l < s_c1; l++)
+            eq = (s_ind_val1[l] == s_ind_val2[l] &&
+                  s_ind_val1[l] == s_ind_val3[l]);
+
+        free(s_ind_val1);
+        free(s_ind_val2);
+        free(s_ind_val3);
+
+        if(!eq){
+            printf("       - The strided searches " ANSI_COLOR_RED
+                   ANSI_STYLE_BOLD "don't agree" ANSI_COLOR_RESET
+                   ANSI_STYLE_NO_BOLD " for i_step = %d (%d %d %d)! "
+                   "Stopping...\n", step, s_c1, s_c2, s_c3);
+
+            free(ind_val1);
+            free(ind_val2);
+            free(ind_val3);
+            free(ind_val4);
+            free(ind_val7);
+
+            return 15;
+        }
+
+        printf(
+"     |  %4d  | %12.1f | %12.1f | %21.1f | \n", step,
+            ((float)n / step) / s_d1, ((float)n / step) / s_d2,
+            ((float)n / step) / s_d3);
+    }
+    printf(
+"     *--------*--------------*--------------*-----------------------* \n");
+
+    //-------------------------------------------------------------------------
+    // How often does each value of [a, b] occur? One thread_find per value
+    // means b - a + 1 full scans of U, a histogram only needs one. The same
+    // goes for the aggregates: thread_aggregate gets the sum, the min, the max
+    // and the number of elements in the lower half of [a, b] in one pass,
+    // where we'd otherwise derive them from all these thread_find calls.
+    //-------------------------------------------------------------------------
+    printf( ANSI_STYLE_BOLD
+"\n  [*] Histogram of [%d, %d] and aggregates (running times in µs): \n\n"
+    ANSI_STYLE_NO_BOLD, a, b);
+
+    width = b - a + 1;
+    hist1 = malloc(width * sizeof(int));
+    hist2 = malloc(width * sizeof(int));
+    hist3 = malloc(width * sizeof(int));
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(i = 0; i < width; i++){
+        hist1[i] = thread_find(test_array, 0, n, 1, a + i, &s_ind_val1, -1,
+                               THREAD_FIND_TWO_PASS);
+        free(s_ind_val1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    vect_histogram(test_array, 0, n, 1, a, b, hist2);
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    thread_histogram(test_array, 0, n, 1, a, b, hist3);
+    clock_gettime(CLOCK_MONOTONIC, &t3);
+    thread_aggregate(test_array, 0, n, 1, a, a + (b - a) / 2, &agg);
+    clock_gettime(CLOCK_MONOTONIC, &t4);
+
+    h_d1 = max(tdiff_micros(t0, t1), 1);
+    h_d2 = max(tdiff_micros(t1, t2), 1);
+    h_d3 = max(tdiff_micros(t2, t3), 1);
+    h_d4 = max(tdiff_micros(t3, t4), 1);
+
+    // What the aggregates should be, according to the first histogram
+    h_sum = 0;
+    h_min = b + 1;
+    h_max = a - 1;
+    h_count_if = 0;
+    for(i = 0; i < width; i++){
+        h_sum += (long long) hist1[i] * (a + i);
+        if(hist1[i] > 0){
+            h_min = min(h_min, a + i);
+            h_max = max(h_max, a + i);
+        }
+        if(i <= (b - a) / 2)
+            h_count_if += hist1[i];
+    }
+
+    eq = !memcmp(hist1, hist2, width * sizeof(int)) &&
+         !memcmp(hist1, hist3, width * sizeof(int)) &&
+         (n == 0 || (agg.min == h_min && agg.max == h_max)) &&
+         agg.n == n && agg.sum == h_sum && agg.count_if == h_count_if;
+
+    free(hist1);
+    free(hist2);
+    free(hist3);
+
+    if(!eq){
+        printf("       - The histograms and aggregates " ANSI_COLOR_RED
+               ANSI_STYLE_BOLD "don't agree" ANSI_COLOR_RESET
+               ANSI_STYLE_NO_BOLD "! Stopping...\n");
+
+        free(ind_val1);
+        free(ind_val2);
+        free(ind_val3);
+        free(ind_val4);
+        free(ind_val7);
+
+        return 16;
+    }
+
+    printf(
+"     *---------------------------*--------------*--------------------* \n"
+"     |      IMPLEMENTATION       | RUNNING TIME | PERFORMANCE FACTOR | \n"
+"     *---------------------------*--------------*--------------------* \n"
+"     | thread_find() per value   | %12ld |      xxxxxxxx      | \n"
+"     | vect_histogram()          | %12ld |       x%7.2f      | \n"
+"     | thread_histogram()        | %12ld |       x%7.2f      | \n"
+"     | thread_aggregate()        | %12ld |       x%7.2f      | \n"
+"     *---------------------------*--------------*--------------------* \n",
+        h_d1, h_d2, ((float)h_d1)/h_d2, h_d3, ((float)h_d1)/h_d3, h_d4,
+        ((float)h_d1)/h_d4);
+
+    //-------------------------------------------------------------------------
+    // At 4 bytes per match, a list of indexes gets huge for frequent values: a
+    // bitmap costs n / 8 bytes whatever the number of matches, runs of
+    // consecutive matches 8 bytes per run. Every representation (and the one
+    // find_result picks from the sampled densities) runs in its own process
+    // so that we get its own peak RSS.
+    //-------------------------------------------------------------------------
+    printf( ANSI_STYLE_BOLD
+"\n  [*] Representations of the matches of %d: \n\n"
+    ANSI_STYLE_NO_BOLD, lookup_value);
+    printf(
+"     *------------------*--------------*--------------*--------------* \n"
+"     |  REPRESENTATION  | RUNNING TIME | RESULT SIZE  |   PEAK RSS   | \n"
+"     |                  |     (µs)     |     (KB)     |    (+KB)     | \n"
+"     *------------------*--------------*--------------*--------------* \n");
+
+    for(repr = RESULT_INDEXES; repr <= RESULT_AUTO; repr++){
+        if(measure_result_repr(test_array, n, lookup_value, repr, ind_val1,
+                               c1, &rm) < 0 || !rm.ok){
+            printf("       - The %s representation " ANSI_COLOR_RED
+                   ANSI_STYLE_BOLD "doesn't hold the expected matches"
+                   ANSI_COLOR_RESET ANSI_STYLE_NO_BOLD "! Stopping...\n",
+                   repr_names[repr]);
+
+            free(ind_val1);
+            free(ind_val2);
+            free(ind_val3);
+            free(ind_val4);
+            free(ind_val7);
+
+            return 17;
+        }
+
+        // Let's show what the automatic choice ended up being
+        if(repr == RESULT_AUTO)
+            snprintf(repr_name, sizeof(repr_name), "auto (%s)",
+                     repr_names[rm.repr]);
+        else
+            snprintf(repr_name, sizeof(repr_name), "%s", repr_names[repr]);
+
+        printf(
+"     | %-16s | %12ld | %12.1f | %12ld | \n", repr_name, rm.micros,
+            rm.bytes / 1024.0, rm.peak_kb);
+    }
+    printf(
+"     *------------------*--------------*--------------*--------------* \n");
+
+
+    //-------------------------------------------------------------------------
+    // Looking for m contiguous values rather than a single one. The pattern is
+    // taken from the middle of the array so that it occurs at least once.
+    //-------------------------------------------------------------------------
+    printf( ANSI_STYLE_BOLD
+"\n  [*] Pattern searches (throughput in M elements/s): \n\n"
+    ANSI_STYLE_NO_BOLD);
+    printf(
+"     *-----*--------------*------------------*-----------------------* \n"
+"     |  m  | find_pattern | vect_find_pattern| thread_find_pattern() | \n"
+"     *-----*--------------*------------------*-----------------------* \n");
+
+    for(i = 0; i < (int)(sizeof(pattern_lengths)/sizeof(int)); i++){
+        m = pattern_lengths[i];
+        if(m > n)
+            break;
+
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        s_c1 = find_pattern(test_array, 0, n, test_array + (n - m) / 2, m,
+                            &s_ind_val1);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        s_c2 = vect_find_pattern(test_array, 0, n, test_array + (n - m) / 2, m,
+                                 &s_ind_val2);
+        clock_gettime(CLOCK_MONOTONIC, &t2);
+        s_c3 = thread_find_pattern(test_array, 0, n, test_array + (n - m) / 2,
+                                   m, &s_ind_val3);
+        clock_gettime(CLOCK_MONOTONIC, &t3);
+
+        s_d1 = max(tdiff_micros(t0, t1), 1);
+        s_d2 = max(tdiff_micros(t1, t2), 1);
+        s_d3 = max(tdiff_micros(t2, t3), 1);
+
+        eq = (s_c1 > 0 && s_c1 == s_c2 && s_c1 == s_c3);
+        for(l = 0; eq && l < s_c1; l++)
+            eq = (s_ind_val1[l] == s_ind_val2[l] &&
+                  s_ind_val1[l] == s_ind_val3[l]);
+
+        free(s_ind_val1);
+        free(s_ind_val2);
+        free(s_ind_val3);
+
+        if(!eq){
+            printf("       - The pattern searches " ANSI_COLOR_RED
+                   ANSI_STYLE_BOLD "don't agree" ANSI_COLOR_RESET
+                   ANSI_STYLE_NO_BOLD " for m = %d (%d %d %d)! "
+                   "Stopping...\n", m, s_c1, s_c2, s_c3);
+
+            free(ind_val1);
+            free(ind_val2);
+            free(ind_val3);
+            free(ind_val4);
+            free(ind_val7);
+
+            return 18;
+        }
+
+        printf(
+"     | %3d | %12.1f | %16.1f | %21.1f | \n", m, (float)n / s_d1,
+            (float)n / s_d2, (float)n / s_d3);
+    }
+    printf(
+"     *-----*--------------*------------------*-----------------------* \n");
+
     printf("\n" ANSI_COLOR_MAGENTA
 " =======================================================================   \n"
 "   The results will be reprinted below for an easier CSV-like parsing.    \n"
@@ -252,20 +832,26 @@ ANSI_STYLE_BOLD            " using different implementations of find: \n\n"
     p_parrallel = ((float)d1)/d3;
     p_parrallel_vect = ((float)d1)/d4;
     p_vect_bis = ((float)d3)/d4;
+    p_two_pass = ((float)d1)/d5;
 
     //-------------------------------------------------------------------------
     // A simple output for scripts to run this program with different sets of
     // parameters, retrieve the performance (you can see this output as a line
     // in a csv file for instance) and draw nice performance graphs!
     //-------------------------------------------------------------------------
-    printf("\n%ld %ld %ld %ld %f %f %f %f\n", d1, d2, d3, d4, p_vect,
-           p_vect_bis, p_parrallel, p_parrallel_vect);
+    printf("\n%ld %ld %ld %ld %f %f %f %f %ld %f %ld %ld %ld %ld\n", d1, d2, d3,
+           d4, p_vect, p_vect_bis, p_parrallel, p_parrallel_vect, d5,
+           p_two_pass, h_d1, h_d2, h_d3, h_d4);
+
+    // The timeline of all the threads we ran, when built with make TRACE=1
+    TRACE_EXPORT("simdbmk_trace.json");
 
 
     free(ind_val1);
     free(ind_val2);
     free(ind_val3);
     free(ind_val4);
+    free(ind_val7);
 
     return 0;
 }
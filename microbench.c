@@ -0,0 +1,1089 @@
+/*
+ * ============================================================================
+ *
+ *       Filename:  microbench.c
+ *
+ *    Description:  A microbenchmark of our find kernels, run one at a time on
+ *                  arrays resident in the different levels of the memory
+ *                  hierarchy, with different hit rates, start alignments and
+ *                  numbers of threads. Every case is printed as a JSON record
+ *                  on its own line so that results can be tracked over time.
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 05:56:32
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  agent (agent@local)
+ *
+ * ============================================================================
+ */
+
+#define _XOPEN_SOURCE 600
+
+// Standard library
+#include <argp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Project
+#include "column.h"
+#include "find.h"
+#include "find_auto.h"
+#include "table.h"
+#include "thread_find.h"
+#include "utilities.h"
+#include "value_set.h"
+
+// The value we look for, every other element of the arrays is in [1, 1000]
+#define LOOKUP_VALUE 0
+
+// On the small arrays we run the kernel several times in a row (and average)
+// so that every measurement covers at least that many elements
+#define MIN_ELEMENTS_PER_MEASURE (1 << 20)
+
+// The largest start offset we test, in ints
+#define MAX_ALIGN 8
+
+// Every kernel gets called through that same signature
+typedef int (*bench_kernel_fn)(int *U, int i_start, int i_end, int i_step,
+                               int val, int **ind_val);
+
+struct bench_kernel{
+    const char *name;
+    bench_kernel_fn fn;
+    // Whether the number of threads matters for that kernel
+    int threaded;
+};
+
+struct size_class{
+    const char *name;
+    int n;
+};
+
+struct bench_arguments{
+    int reps;
+    int max_size;
+    int i_step;
+    char *threads;
+    char *suites;
+    int thread_counts[64];
+    int n_thread_counts;
+};
+
+// A set of cases, returning how many of them failed
+typedef int (*bench_suite_fn)(struct bench_arguments *arguments);
+
+struct bench_suite{
+    const char *name;
+    bench_suite_fn fn;
+};
+
+//-----------------------------------------------------------------------------
+// The kernels
+//-----------------------------------------------------------------------------
+static int bench_vect_count(int *U, int i_start, int i_end, int i_step,
+                            int val, int **ind_val){
+    (*ind_val) = NULL;
+    return vect_count(U, i_start, i_end, i_step, val);
+}
+
+static int bench_thread_find_scalar(int *U, int i_start, int i_end,
+                                    int i_step, int val, int **ind_val){
+    return thread_find(U, i_start, i_end, i_step, val, ind_val, -1,
+                       THREAD_FIND_SCALAR);
+}
+
+static int bench_thread_find_vect(int *U, int i_start, int i_end, int i_step,
+                                  int val, int **ind_val){
+    return thread_find(U, i_start, i_end, i_step, val, ind_val, -1,
+                       THREAD_FIND_VECT);
+}
+
+static int bench_thread_find_two_pass(int *U, int i_start, int i_end,
+                                      int i_step, int val, int **ind_val){
+    return thread_find(U, i_start, i_end, i_step, val, ind_val, -1,
+                       THREAD_FIND_TWO_PASS);
+}
+
+static int bench_thread_find_auto(int *U, int i_start, int i_end, int i_step,
+                                  int val, int **ind_val){
+    return thread_find(U, i_start, i_end, i_step, val, ind_val, -1,
+                       THREAD_FIND_AUTO);
+}
+
+static struct bench_kernel kernels[] = {
+    { "find",                   &find,                       0 },
+    { "vect_find",              &vect_find,                  0 },
+    { "vect_count",             &bench_vect_count,           0 },
+    { "vect_find_compress",     &vect_find_compress,         0 },
+    { "find_auto",              &find_auto,                  0 },
+    { "thread_find_scalar",     &bench_thread_find_scalar,   1 },
+    { "thread_find_vect",       &bench_thread_find_vect,     1 },
+    { "thread_find_two_pass",   &bench_thread_find_two_pass, 1 },
+    { "thread_find_auto",       &bench_thread_find_auto,     1 },
+};
+
+// L1 and L2 sizes are the usual 32KB / 256KB per core minus some room for the
+// results, LLC a few MBs, DRAM way more than any LLC.
+static struct size_class size_classes[] = {
+    { "L1",     4096 },
+    { "L2",     49152 },
+    { "LLC",    1048576 },
+    { "DRAM",   67108864 },
+};
+
+static float hit_rates[] = {0.0, 0.001, 0.01, 0.1, 0.5};
+
+static int aligns[] = {0, 1, 3, MAX_ALIGN};
+
+//-----------------------------------------------------------------------------
+// CLI arguments
+//-----------------------------------------------------------------------------
+static char doc[] = "Runs every find kernel on its own for several array "
+                    "sizes, hit rates, start alignments and thread counts and "
+                    "prints one JSON record per case.";
+static char args_doc[] = "";
+static struct argp_option options[] = {
+    { "reps", 'r', "COUNT", 0, "The number of measurements per case, the "
+        "minimum and the median are reported (default: 5)."},
+    { "max-size", 'm', "COUNT", 0, "Skips the size classes with more "
+        "elements than that (default: no limit)."},
+    { "step", 's', "COUNT", 0, "The i_step to search with (default: 1)."},
+    { "threads", 't', "LIST", 0, "A comma-separated list of thread counts "
+        "for the multithreaded kernels (default: 1 and the number of cores)."},
+    { "suite", 'S', "LIST", 0, "A comma-separated list of the suites to run: "
+        "kernels, updates, sets and/or tables (default: all of them)."},
+    { 0 }
+};
+
+/**
+ * Parses a comma-separated list of positive ints into list (at most max_len
+ * of them) and returns how many were read.
+ */
+static int parse_int_list(char *str, int *list, int max_len){
+    int len = 0;
+    char *tok, *saveptr;
+
+    for(tok = strtok_r(str, ",", &saveptr); tok != NULL && len < max_len;
+        tok = strtok_r(NULL, ",", &saveptr)){
+        if(atoi(tok) > 0)
+            list[len++] = atoi(tok);
+    }
+
+    return len;
+}
+
+static error_t parse_opt(int key, char *arg, struct argp_state *state){
+    struct bench_arguments *arguments = state->input;
+    switch (key) {
+        case 'r': arguments->reps = max(atoi(arg), 1); break;
+        case 'm': arguments->max_size = atoi(arg); break;
+        case 's': arguments->i_step = max(atoi(arg), 1); break;
+        case 't':
+            arguments->threads = arg;
+            arguments->n_thread_counts = parse_int_list(arg,
+                                                arguments->thread_counts, 64);
+            // Running none of the threaded cases isn't what was asked for
+            if(arguments->n_thread_counts == 0)
+                argp_error(state, "--threads needs at least one positive "
+                           "count");
+            break;
+        case 'S': arguments->suites = arg; break;
+        case ARGP_KEY_ARG: return 0;
+        default: return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+static struct argp argp = { options, parse_opt, args_doc, doc };
+
+//-----------------------------------------------------------------------------
+// The benchmark itself
+//-----------------------------------------------------------------------------
+static int cmp_long(const void *a, const void *b){
+    long x = *(const long*) a, y = *(const long*) b;
+    return (x > y) - (x < y);
+}
+
+// One call of the kernel of a case on whatever it runs on (arg): returns the
+// number of matches and puts their positions in *ind_val (NULL for the
+// counting kernels)
+typedef int (*bench_call_fn)(void *arg, int **ind_val);
+
+// What time_case measured
+struct bench_timing{
+    int matches;
+    int ok;
+    long min_ns;
+    long median_ns;
+};
+
+/**
+ * Times call on n elements with n_threads threads, reps times (each of them
+ * averaged over enough calls to cover MIN_ELEMENTS_PER_MEASURE elements). ok
+ * tells whether it found the expected matches, at the positions in
+ * expected_ind_val.
+ */
+static void time_case(bench_call_fn call, void *arg, int n, int n_threads,
+                      int reps, int expected, int *expected_ind_val,
+                      struct bench_timing *timing){
+    int r, j, inner;
+    int *ind_val;
+    long *times;
+    struct timespec t0, t1;
+
+    inner = max(1, MIN_ELEMENTS_PER_MEASURE / n);
+    times = malloc(reps * sizeof(long));
+
+    set_number_of_threads(n_threads);
+
+    // One warm-up run so that the data is where its size class says, which
+    // also tells us if the kernel is right (the counting kernels don't return
+    // any position)
+    timing->matches = call(arg, &ind_val);
+    timing->ok = (timing->matches == expected) &&
+                 (ind_val == NULL || timing->matches == 0 ||
+                  !memcmp(ind_val, expected_ind_val,
+                          timing->matches * sizeof(int)));
+    free(ind_val);
+
+    for(r = 0; r < reps; r++){
+        times[r] = 0;
+        for(j = 0; j < inner; j++){
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            call(arg, &ind_val);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            times[r] += tdiff_nanos(t0, t1);
+            free(ind_val);
+        }
+        times[r] /= inner;
+    }
+
+    qsort(times, reps, sizeof(long), &cmp_long);
+
+    timing->min_ns = times[0];
+    timing->median_ns = times[reps / 2];
+
+    free(times);
+}
+
+/**
+ * Fills U with values in [1, 1000], apart from a fraction hit_rate of them
+ * (randomly spread) which are set to LOOKUP_VALUE.
+ */
+static void fill_array_with_hit_rate(int *U, int n, float hit_rate){
+    int i;
+
+    for(i = 0; i < n; i++){
+        if((float) rand() / RAND_MAX < hit_rate)
+            U[i] = LOOKUP_VALUE;
+        else
+            U[i] = rand() % 1000 + 1;
+    }
+}
+
+struct kernel_call{
+    struct bench_kernel *kernel;
+    int *U;
+    int i_start;
+    int i_end;
+    int i_step;
+};
+
+static int call_kernel(void *arg, int **ind_val){
+    struct kernel_call *kc = arg;
+
+    return kc->kernel->fn(kc->U, kc->i_start, kc->i_end, kc->i_step,
+                          LOOKUP_VALUE, ind_val);
+}
+
+/**
+ * Runs one case and prints its JSON record. Returns 0 if the kernel found the
+ * same matches as find did (expected of them, at the positions in
+ * expected_ind_val), 1 otherwise.
+ */
+static int run_case(struct bench_kernel *kernel, struct size_class *size,
+                    float hit_rate, int align, int n_threads, int i_step,
+                    int reps, int *U, int expected, int *expected_ind_val){
+    struct kernel_call kc = { kernel, U, align, align + size->n, i_step };
+    struct bench_timing tm;
+
+    time_case(&call_kernel, &kc, size->n, n_threads, reps, expected,
+              expected_ind_val, &tm);
+
+    printf("{\"suite\": \"kernels\", \"kernel\": \"%s\", \"size_class\": "
+           "\"%s\", \"n\": %d, \"hit_rate\": %g, \"align\": %d, "
+           "\"threads\": %d, \"step\": %d, \"reps\": %d, \"matches\": %d, "
+           "\"ok\": %s, \"min_ns\": %ld, \"median_ns\": %ld, "
+           "\"melem_per_s\": %.1f}\n", kernel->name,
+           size->name, size->n, hit_rate, align, n_threads, i_step, reps,
+           tm.matches, tm.ok ? "true" : "false", tm.min_ns, tm.median_ns,
+           1000.0 * size->n / max(tm.min_ns, 1L));
+    fflush(stdout);
+
+    return !tm.ok;
+}
+
+/**
+ * Every kernel on its own, for every size class, hit rate, alignment and
+ * thread count.
+ */
+static int run_kernel_suite(struct bench_arguments *arguments){
+    int s, h, a, kn, t, expected, failures;
+    int *U, *expected_ind_val;
+    struct bench_kernel *kernel;
+    struct size_class *size;
+
+    failures = 0;
+
+    for(s = 0; s < (int)(sizeof(size_classes)/sizeof(struct size_class));
+        s++){
+        size = &size_classes[s];
+        if(arguments->max_size > 0 && size->n > arguments->max_size)
+            continue;
+
+        posix_memalign((void**) &U, 32, sizeof(int) * (size->n + MAX_ALIGN));
+
+        for(h = 0; h < (int)(sizeof(hit_rates)/sizeof(float)); h++){
+            fill_array_with_hit_rate(U, size->n + MAX_ALIGN, hit_rates[h]);
+
+            for(a = 0; a < (int)(sizeof(aligns)/sizeof(int)); a++){
+                // The reference results of that case
+                expected = find(U, aligns[a], aligns[a] + size->n,
+                                arguments->i_step, LOOKUP_VALUE,
+                                &expected_ind_val);
+
+                for(kn = 0; kn < (int)(sizeof(kernels)/
+                                       sizeof(struct bench_kernel)); kn++){
+                    kernel = &kernels[kn];
+
+                    for(t = 0; t < (kernel->threaded ?
+                                    arguments->n_thread_counts : 1); t++){
+                        failures += run_case(kernel, size, hit_rates[h],
+                                             aligns[a],
+                                             kernel->threaded ?
+                                                arguments->thread_counts[t] : 1,
+                                             arguments->i_step, arguments->reps,
+                                             U, expected, expected_ind_val);
+                    }
+                }
+
+                free(expected_ind_val);
+            }
+        }
+
+        free(U);
+    }
+
+    return failures;
+}
+
+//-----------------------------------------------------------------------------
+// Incremental updates under a mixed read/write load
+//-----------------------------------------------------------------------------
+
+// Every case runs that many operations on a column of its size class: writes
+// (appends of UPDATE_APPEND_LEN elements or overwrites of UPDATE_OVERWRITE_LEN
+// of them, half and half) with probability write_ratio, reads (column_count
+// or column_find of a random value, half and half) otherwise
+#define UPDATE_OPS              2000
+#define UPDATE_APPEND_LEN       256
+#define UPDATE_OVERWRITE_LEN    64
+
+// The values of the columns are in [0, UPDATE_DOMAIN]
+#define UPDATE_DOMAIN           1000
+
+static float write_ratios[] = {0.0, 0.1, 0.5, 0.9};
+
+/**
+ * Whether the counts and the searches of col still agree with plain scans of
+ * its elements after all these updates.
+ */
+static int check_column(struct column *col){
+    int v, c, ok;
+    int *ind_val, *expected_ind_val;
+
+    ok = 1;
+    for(v = 0; v <= UPDATE_DOMAIN && ok; v++)
+        ok = (column_count(col, v) == vect_count(col->U, 0, col->n, 1, v));
+
+    for(v = 0; v <= UPDATE_DOMAIN && ok; v += 97){
+        c = column_find(col, v, &ind_val);
+        ok = (c == find(col->U, 0, col->n, 1, v, &expected_ind_val)) &&
+             (c == 0 || !memcmp(ind_val, expected_ind_val, c * sizeof(int)));
+        free(ind_val);
+        free(expected_ind_val);
+    }
+
+    return ok;
+}
+
+static int run_update_case(struct size_class *size, float write_ratio,
+                           int n_threads, int *U){
+    int o, i, n_reads, n_writes, ok;
+    int vals[UPDATE_APPEND_LEN];
+    int *ind_val;
+    long build_ns, write_ns;
+    long *read_ns;
+    struct column *col;
+    struct timespec t0, t1;
+
+    read_ns = malloc(UPDATE_OPS * sizeof(long));
+    set_number_of_threads(n_threads);
+
+    // The full build that the incremental updates save us from
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    col = column_create(U, size->n, 0, UPDATE_DOMAIN);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    build_ns = tdiff_nanos(t0, t1);
+
+    n_reads = 0;
+    n_writes = 0;
+    write_ns = 0;
+
+    for(o = 0; o < UPDATE_OPS; o++){
+        if((float) rand() / RAND_MAX < write_ratio){
+            for(i = 0; i < UPDATE_APPEND_LEN; i++)
+                vals[i] = rand() % (UPDATE_DOMAIN + 1);
+
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            if(n_writes % 2)
+                column_append(col, vals, UPDATE_APPEND_LEN);
+            else
+                column_overwrite(col, rand() % (col->n - UPDATE_OVERWRITE_LEN),
+                                 vals, UPDATE_OVERWRITE_LEN);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+
+            write_ns += tdiff_nanos(t0, t1);
+            n_writes++;
+        } else {
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            if(n_reads % 2)
+                column_count(col, rand() % (UPDATE_DOMAIN + 1));
+            else {
+                column_find(col, rand() % (UPDATE_DOMAIN + 1), &ind_val);
+                free(ind_val);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+
+            read_ns[n_reads++] = tdiff_nanos(t0, t1);
+        }
+    }
+
+    qsort(read_ns, n_reads, sizeof(long), &cmp_long);
+    ok = check_column(col);
+
+    printf("{\"suite\": \"updates\", \"mode\": \"serial\", "
+           "\"size_class\": \"%s\", \"n\": %d, \"write_ratio\": %g, \"threads\": %d, \"ops\": %d, "
+           "\"final_n\": %d, \"ok\": %s, \"build_ns\": %ld, "
+           "\"writes_per_s\": %.1f, \"read_p50_ns\": %ld, "
+           "\"read_p99_ns\": %ld}\n", size->name, size->n, write_ratio,
+           n_threads, UPDATE_OPS, col->n, ok ? "true" : "false", build_ns,
+           n_writes ? 1e9 * n_writes / max(write_ns, 1L) : 0.0,
+           n_reads ? read_ns[n_reads / 2] : 0L,
+           n_reads ? read_ns[n_reads * 99 / 100] : 0L);
+    fflush(stdout);
+
+    column_free(col);
+    free(read_ns);
+
+    return !ok;
+}
+
+// What the reader threads of a concurrent case share with the writer one
+struct concurrent_update{
+    struct column *col;
+    volatile int done;
+};
+
+// Every reader keeps the latencies of its reads, at most
+// UPDATE_CONCURRENT_MAX_READS of them
+#define UPDATE_CONCURRENT_MAX_READS (4 * UPDATE_OPS)
+
+struct update_reader{
+    struct concurrent_update *shared;
+    unsigned int seed;
+    int n_reads;
+    long *read_ns;
+};
+
+static void* update_reader_threadable(void *args){
+    int *ind_val;
+    struct update_reader *reader = args;
+    struct timespec t0, t1;
+
+    while(!reader->shared->done &&
+          reader->n_reads < UPDATE_CONCURRENT_MAX_READS){
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        if(reader->n_reads % 2)
+            column_count(reader->shared->col,
+                         rand_r(&reader->seed) % (UPDATE_DOMAIN + 1));
+        else {
+            column_find(reader->shared->col,
+                        rand_r(&reader->seed) % (UPDATE_DOMAIN + 1),
+                        &ind_val);
+            free(ind_val);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+
+        reader->read_ns[reader->n_reads++] = tdiff_nanos(t0, t1);
+    }
+
+    return NULL;
+}
+
+/**
+ * The same load as run_update_case, but with n_readers threads reading the
+ * column while the calling thread writes UPDATE_OPS / 2 times to it, so that
+ * the writes really have to wait for the reads (and the other way around).
+ */
+static int run_concurrent_update_case(struct size_class *size, int n_readers,
+                                      int *U){
+    int o, i, r, n_reads, ok;
+    int vals[UPDATE_APPEND_LEN];
+    long write_ns;
+    long *read_ns;
+    pthread_t *threads;
+    struct update_reader *readers;
+    struct concurrent_update shared;
+    struct timespec t0, t1;
+
+    // The readers are the parallelism here, column_find stays on their thread
+    set_number_of_threads(1);
+
+    shared.col = column_create(U, size->n, 0, UPDATE_DOMAIN);
+    shared.done = 0;
+
+    threads = malloc(n_readers * sizeof(pthread_t));
+    readers = malloc(n_readers * sizeof(struct update_reader));
+    for(r = 0; r < n_readers; r++){
+        readers[r].shared = &shared;
+        readers[r].seed = rand();
+        readers[r].n_reads = 0;
+        readers[r].read_ns = malloc(UPDATE_CONCURRENT_MAX_READS *
+                                    sizeof(long));
+        pthread_create(&threads[r], NULL, &update_reader_threadable,
+                       &readers[r]);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(o = 0; o < UPDATE_OPS / 2; o++){
+        for(i = 0; i < UPDATE_APPEND_LEN; i++)
+            vals[i] = rand() % (UPDATE_DOMAIN + 1);
+
+        if(o % 2)
+            column_append(shared.col, vals, UPDATE_APPEND_LEN);
+        else
+            column_overwrite(shared.col,
+                             rand() % (shared.col->n - UPDATE_OVERWRITE_LEN),
+                             vals, UPDATE_OVERWRITE_LEN);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    write_ns = tdiff_nanos(t0, t1);
+
+    shared.done = 1;
+
+    // All the latencies together
+    n_reads = 0;
+    read_ns = malloc(n_readers * UPDATE_CONCURRENT_MAX_READS * sizeof(long));
+    for(r = 0; r < n_readers; r++){
+        pthread_join(threads[r], NULL);
+        memcpy(read_ns + n_reads, readers[r].read_ns,
+               readers[r].n_reads * sizeof(long));
+        n_reads += readers[r].n_reads;
+        free(readers[r].read_ns);
+    }
+
+    qsort(read_ns, n_reads, sizeof(long), &cmp_long);
+    ok = check_column(shared.col);
+
+    printf("{\"suite\": \"updates\", \"mode\": \"concurrent\", "
+           "\"size_class\": \"%s\", \"n\": %d, \"readers\": %d, "
+           "\"writes\": %d, \"reads\": %d, \"final_n\": %d, \"ok\": %s, "
+           "\"writes_per_s\": %.1f, \"read_p50_ns\": %ld, "
+           "\"read_p99_ns\": %ld}\n", size->name, size->n, n_readers,
+           UPDATE_OPS / 2, n_reads, shared.col->n, ok ? "true" : "false",
+           1e9 * (UPDATE_OPS / 2) / max(write_ns, 1L),
+           n_reads ? read_ns[n_reads / 2] : 0L,
+           n_reads ? read_ns[n_reads * 99 / 100] : 0L);
+    fflush(stdout);
+
+    column_free(shared.col);
+    free(read_ns);
+    free(readers);
+    free(threads);
+
+    return !ok;
+}
+
+/**
+ * Mixed read/write loads on columns of every size class but DRAM (checking
+ * such a column value by value would take ages), for every write ratio and
+ * thread count, one operation after the other. Then the same with readers
+ * and a writer running at the same time, for every thread count.
+ */
+static int run_update_suite(struct bench_arguments *arguments){
+    int s, w, t, failures;
+    int *U;
+    struct size_class *size;
+
+    failures = 0;
+
+    for(s = 0; s < (int)(sizeof(size_classes)/sizeof(struct size_class)) - 1;
+        s++){
+        size = &size_classes[s];
+        if(arguments->max_size > 0 && size->n > arguments->max_size)
+            continue;
+
+        U = malloc(size->n * sizeof(int));
+        fill_array(U, size->n, 0, UPDATE_DOMAIN);
+
+        for(w = 0; w < (int)(sizeof(write_ratios)/sizeof(float)); w++){
+            for(t = 0; t < arguments->n_thread_counts; t++)
+                failures += run_update_case(size, write_ratios[w],
+                                            arguments->thread_counts[t], U);
+        }
+
+        for(t = 0; t < arguments->n_thread_counts; t++)
+            failures += run_concurrent_update_case(size,
+                                                   arguments->thread_counts[t],
+                                                   U);
+
+        free(U);
+    }
+
+    return failures;
+}
+
+//-----------------------------------------------------------------------------
+// Membership searches against large sets of values
+//-----------------------------------------------------------------------------
+
+// The values of a set are even, one picked at random out of every
+// SET_SPREAD consecutive even numbers: the elements that aren't hits are odd
+// numbers of the same range, so that they go through the whole probe
+#define SET_SPREAD 8
+
+typedef int (*set_kernel_fn)(int *U, int i_start, int i_end, int i_step,
+                             const struct value_set *set, int **ind_val);
+
+struct set_kernel{
+    const char *name;
+    set_kernel_fn fn;
+    int threaded;
+};
+
+static int bench_vect_count_in_set(int *U, int i_start, int i_end, int i_step,
+                                   const struct value_set *set,
+                                   int **ind_val){
+    (*ind_val) = NULL;
+    return vect_count_in_set(U, i_start, i_end, i_step, set);
+}
+
+static struct set_kernel set_kernels[] = {
+    { "find_in_set",            &find_in_set,               0 },
+    { "vect_find_in_set",       &vect_find_in_set,          0 },
+    { "vect_count_in_set",      &bench_vect_count_in_set,   0 },
+    { "thread_find_in_set",     &thread_find_in_set,        1 },
+};
+
+static int set_sizes[] = {16, 1024, 65536, 1048576};
+
+static float set_hit_rates[] = {0.01, 0.1, 0.5, 0.9};
+
+static const char *set_kind_names[] = {"bitmap", "hash"};
+
+/**
+ * Fills U with the values of the set (picked at random) for a fraction
+ * hit_rate of its elements, with values that aren't in it otherwise.
+ */
+static void fill_array_from_set(int *U, int n, int *values, int n_values,
+                                float hit_rate){
+    int i;
+
+    for(i = 0; i < n; i++){
+        if((float) rand() / RAND_MAX < hit_rate)
+            U[i] = values[rand() % n_values];
+        else
+            U[i] = 2 * (rand() % (n_values * SET_SPREAD)) + 1;
+    }
+}
+
+struct set_call{
+    struct set_kernel *kernel;
+    int *U;
+    int n;
+    int i_step;
+    struct value_set *set;
+};
+
+static int call_set_kernel(void *arg, int **ind_val){
+    struct set_call *sc = arg;
+
+    return sc->kernel->fn(sc->U, 0, sc->n, sc->i_step, sc->set, ind_val);
+}
+
+static int run_set_case(struct set_kernel *kernel, struct size_class *size,
+                        struct value_set *set, float hit_rate, int n_threads,
+                        int i_step, int reps, int *U, int expected,
+                        int *expected_ind_val){
+    struct set_call sc = { kernel, U, size->n, i_step, set };
+    struct bench_timing tm;
+
+    time_case(&call_set_kernel, &sc, size->n, n_threads, reps, expected,
+              expected_ind_val, &tm);
+
+    printf("{\"suite\": \"sets\", \"kernel\": \"%s\", \"set_kind\": "
+           "\"%s\", \"set_size\": %d, \"size_class\": \"%s\", \"n\": %d, "
+           "\"hit_rate\": %g, \"threads\": %d, \"step\": %d, \"reps\": %d, "
+           "\"matches\": %d, \"ok\": %s, \"min_ns\": %ld, "
+           "\"median_ns\": %ld, \"melem_per_s\": %.1f}\n", kernel->name,
+           set_kind_names[set->kind], set->n, size->name, size->n, hit_rate,
+           n_threads, i_step, reps, tm.matches, tm.ok ? "true" : "false",
+           tm.min_ns, tm.median_ns, 1000.0 * size->n / max(tm.min_ns, 1L));
+    fflush(stdout);
+
+    return !tm.ok;
+}
+
+/**
+ * Every set kernel against sets of every size in both representations, for
+ * every size class but DRAM, hit rate and thread count.
+ */
+static int run_set_suite(struct bench_arguments *arguments){
+    int s, z, h, kind, kn, t, j, expected, failures;
+    int *U, *values, *expected_ind_val;
+    struct set_kernel *kernel;
+    struct size_class *size;
+    struct value_set *set;
+
+    failures = 0;
+
+    for(s = 0; s < (int)(sizeof(size_classes)/sizeof(struct size_class)) - 1;
+        s++){
+        size = &size_classes[s];
+        if(arguments->max_size > 0 && size->n > arguments->max_size)
+            continue;
+
+        U = malloc(size->n * sizeof(int));
+
+        for(z = 0; z < (int)(sizeof(set_sizes)/sizeof(int)); z++){
+            values = malloc(set_sizes[z] * sizeof(int));
+            for(j = 0; j < set_sizes[z]; j++)
+                values[j] = 2 * (j * SET_SPREAD + rand() % SET_SPREAD);
+
+            for(h = 0; h < (int)(sizeof(set_hit_rates)/sizeof(float)); h++){
+                fill_array_from_set(U, size->n, values, set_sizes[z],
+                                    set_hit_rates[h]);
+
+                for(kind = VALUE_SET_BITMAP; kind <= VALUE_SET_HASH; kind++){
+                    set = value_set_create(values, set_sizes[z], kind);
+                    expected = find_in_set(U, 0, size->n, arguments->i_step,
+                                           set, &expected_ind_val);
+
+                    for(kn = 0; kn < (int)(sizeof(set_kernels)/
+                                           sizeof(struct set_kernel)); kn++){
+                        kernel = &set_kernels[kn];
+
+                        for(t = 0; t < (kernel->threaded ?
+                                        arguments->n_thread_counts : 1); t++){
+                            failures += run_set_case(kernel, size, set,
+                                            set_hit_rates[h],
+                                            kernel->threaded ?
+                                                arguments->thread_counts[t] : 1,
+                                            arguments->i_step, arguments->reps,
+                                            U, expected, expected_ind_val);
+                        }
+                    }
+
+                    free(expected_ind_val);
+                    value_set_free(set);
+                }
+            }
+
+            free(values);
+        }
+
+        free(U);
+    }
+
+    return failures;
+}
+
+//-----------------------------------------------------------------------------
+// Conjunctive predicates over several columns
+//-----------------------------------------------------------------------------
+
+// The tables have 3 columns: the first one in [0, 999] (random or sorted, to
+// see the blocks get skipped), the second one in [0, 999] and the last one in
+// [0, 9]. The query is "col0 in [0, selectivity * 1000 - 1] AND col1 in
+// [0, 499] AND col2 == 3".
+#define TABLE_COLUMNS 3
+
+typedef int (*table_kernel_fn)(struct table *tab, struct predicate *preds,
+                               int n_preds, int **ind_val);
+
+struct table_kernel{
+    const char *name;
+    table_kernel_fn fn;
+    int threaded;
+};
+
+static int bench_table_find(struct table *tab, struct predicate *preds,
+                            int n_preds, int **ind_val){
+    return table_find(tab, 0, tab->n, preds, n_preds, ind_val);
+}
+
+static int bench_vect_table_find(struct table *tab, struct predicate *preds,
+                                 int n_preds, int **ind_val){
+    return vect_table_find(tab, 0, tab->n, preds, n_preds, ind_val);
+}
+
+static int bench_vect_table_count(struct table *tab, struct predicate *preds,
+                                  int n_preds, int **ind_val){
+    (*ind_val) = NULL;
+    return vect_table_count(tab, 0, tab->n, preds, n_preds);
+}
+
+/**
+ * What we'd do without tables: every column searched on its own (thread_find
+ * for an equality, thread_find_in_set with the values of [lo, hi] for a
+ * range), then the sorted lists of indexes intersected one after the other.
+ */
+static int bench_per_column(struct table *tab, struct predicate *preds,
+                            int n_preds, int **ind_val){
+    int k, v, i, j, c, c_k;
+    int *ind_k, *values;
+    struct value_set *set;
+
+    c = 0;
+    (*ind_val) = NULL;
+
+    for(k = 0; k < n_preds; k++){
+        if(preds[k].lo == preds[k].hi)
+            c_k = thread_find(tab->columns[preds[k].column], 0, tab->n, 1,
+                              preds[k].lo, &ind_k, -1, THREAD_FIND_AUTO);
+        else {
+            values = malloc((preds[k].hi - preds[k].lo + 1) * sizeof(int));
+            for(v = preds[k].lo; v <= preds[k].hi; v++)
+                values[v - preds[k].lo] = v;
+            set = value_set_create(values, preds[k].hi - preds[k].lo + 1,
+                                   VALUE_SET_AUTO);
+            c_k = thread_find_in_set(tab->columns[preds[k].column], 0, tab->n,
+                                     1, set, &ind_k);
+            value_set_free(set);
+            free(values);
+        }
+
+        if(k == 0){
+            (*ind_val) = ind_k;
+            c = c_k;
+            continue;
+        }
+
+        // Both lists are sorted: a merge keeps what's in both, in place
+        for(i = 0, j = 0, v = 0; i < c && j < c_k; ){
+            if((*ind_val)[i] < ind_k[j])
+                i++;
+            else if((*ind_val)[i] > ind_k[j])
+                j++;
+            else {
+                (*ind_val)[v++] = (*ind_val)[i];
+                i++;
+                j++;
+            }
+        }
+        c = v;
+        free(ind_k);
+    }
+
+    return c;
+}
+
+static struct table_kernel table_kernels[] = {
+    { "table_find",             &bench_table_find,          0 },
+    { "vect_table_find",        &bench_vect_table_find,     0 },
+    { "vect_table_count",       &bench_vect_table_count,    0 },
+    { "thread_table_find",      &thread_table_find,         1 },
+    { "per_column_intersect",   &bench_per_column,          1 },
+};
+
+static float table_selectivities[] = {0.001, 0.01, 0.1, 0.5};
+
+static const char *table_layouts[] = {"random", "sorted"};
+
+struct table_call{
+    struct table_kernel *kernel;
+    struct table *tab;
+    struct predicate *preds;
+    int n_preds;
+};
+
+static int call_table_kernel(void *arg, int **ind_val){
+    struct table_call *tc = arg;
+
+    return tc->kernel->fn(tc->tab, tc->preds, tc->n_preds, ind_val);
+}
+
+static int run_table_case(struct table_kernel *kernel, struct size_class *size,
+                          const char *layout, float selectivity,
+                          struct table *tab, struct predicate *preds,
+                          int n_preds, int n_threads, int reps, int expected,
+                          int *expected_ind_val){
+    struct table_call tc = { kernel, tab, preds, n_preds };
+    struct bench_timing tm;
+
+    time_case(&call_table_kernel, &tc, size->n, n_threads, reps, expected,
+              expected_ind_val, &tm);
+
+    printf("{\"suite\": \"tables\", \"kernel\": \"%s\", \"layout\": "
+           "\"%s\", \"size_class\": \"%s\", \"n\": %d, \"columns\": %d, "
+           "\"selectivity\": %g, \"threads\": %d, \"reps\": %d, "
+           "\"matches\": %d, \"ok\": %s, \"min_ns\": %ld, "
+           "\"median_ns\": %ld, \"mrows_per_s\": %.1f}\n", kernel->name,
+           layout, size->name, size->n, tab->n_columns, selectivity,
+           n_threads, reps, tm.matches, tm.ok ? "true" : "false", tm.min_ns,
+           tm.median_ns, 1000.0 * size->n / max(tm.min_ns, 1L));
+    fflush(stdout);
+
+    return !tm.ok;
+}
+
+/**
+ * Every table kernel for every size class but DRAM, layout of the first
+ * column, selectivity of the first predicate and thread count.
+ */
+static int run_table_suite(struct bench_arguments *arguments){
+    int s, l, h, k, kn, t, i, expected, failures;
+    int *columns[TABLE_COLUMNS], *expected_ind_val;
+    struct table_kernel *kernel;
+    struct size_class *size;
+    struct table *tab;
+    struct predicate preds[TABLE_COLUMNS] = {
+        { 0, 0, 0 },
+        { 1, 0, 499 },
+        { 2, 3, 3 },
+    };
+
+    failures = 0;
+
+    for(s = 0; s < (int)(sizeof(size_classes)/sizeof(struct size_class)) - 1;
+        s++){
+        size = &size_classes[s];
+        if(arguments->max_size > 0 && size->n > arguments->max_size)
+            continue;
+
+        for(k = 0; k < TABLE_COLUMNS; k++)
+            posix_memalign((void**) &columns[k], 32, size->n * sizeof(int));
+
+        for(l = 0; l < (int)(sizeof(table_layouts)/sizeof(char*)); l++){
+            // Row by row from the same rand() stream, so that the columns are
+            // independent of each other: the query then matches about
+            // n * selectivity * 0.5 * 0.1 rows
+            for(i = 0; i < size->n; i++){
+                columns[0][i] = (l == 0) ? rand() % 1000 :
+                                           (int)((long) i * 1000 / size->n);
+                columns[1][i] = rand() % 1000;
+                columns[2][i] = rand() % 10;
+            }
+
+            tab = table_create(columns, TABLE_COLUMNS, size->n);
+
+            for(h = 0; h < (int)(sizeof(table_selectivities)/sizeof(float));
+                h++){
+                preds[0].hi = (int)(table_selectivities[h] * 1000) - 1;
+                expected = table_find(tab, 0, size->n, preds, TABLE_COLUMNS,
+                                      &expected_ind_val);
+
+                for(kn = 0; kn < (int)(sizeof(table_kernels)/
+                                       sizeof(struct table_kernel)); kn++){
+                    kernel = &table_kernels[kn];
+
+                    for(t = 0; t < (kernel->threaded ?
+                                    arguments->n_thread_counts : 1); t++){
+                        failures += run_table_case(kernel, size,
+                                        table_layouts[l],
+                                        table_selectivities[h], tab, preds,
+                                        TABLE_COLUMNS,
+                                        kernel->threaded ?
+                                            arguments->thread_counts[t] : 1,
+                                        arguments->reps, expected,
+                                        expected_ind_val);
+                    }
+                }
+
+                free(expected_ind_val);
+            }
+
+            table_free(tab);
+        }
+
+        for(k = 0; k < TABLE_COLUMNS; k++)
+            free(columns[k]);
+    }
+
+    return failures;
+}
+
+static struct bench_suite suites[] = {
+    { "kernels",    &run_kernel_suite },
+    { "updates",    &run_update_suite },
+    { "sets",       &run_set_suite },
+    { "tables",     &run_table_suite },
+};
+
+/**
+ * Whether name is one of the items of the comma-separated list (or list is
+ * NULL).
+ */
+static int in_list(const char *list, const char *name){
+    const char *p;
+    size_t len = strlen(name);
+
+    if(list == NULL)
+        return 1;
+
+    for(p = strstr(list, name); p != NULL; p = strstr(p + 1, name)){
+        if((p == list || p[-1] == ',') && (p[len] == ',' || p[len] == '\0'))
+            return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv){
+    int s, failures;
+    struct bench_arguments arguments;
+
+    arguments.reps = 5;
+    arguments.max_size = -1;
+    arguments.i_step = 1;
+    arguments.threads = NULL;
+    arguments.suites = NULL;
+
+    argp_parse(&argp, argc, argv, 0, 0, &arguments);
+
+    // Otherwise --threads already filled them
+    if(arguments.threads == NULL){
+        arguments.thread_counts[0] = 1;
+        arguments.thread_counts[1] = get_number_of_cores();
+        arguments.n_thread_counts = (arguments.thread_counts[1] > 1) ? 2 : 1;
+    }
+
+    srand(42);
+    failures = 0;
+
+    for(s = 0; s < (int)(sizeof(suites)/sizeof(struct bench_suite)); s++){
+        if(in_list(arguments.suites, suites[s].name))
+            failures += suites[s].fn(&arguments);
+    }
+
+    if(failures > 0)
+        fprintf(stderr, "%d case(s) went wrong!\n", failures);
+
+    return failures > 0;
+}
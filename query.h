@@ -0,0 +1,68 @@
+/*
+ * ============================================================================
+ *
+ *       Filename:  query.h
+ *
+ *    Description:  What simdsrv (the resident query server) and its clients
+ *                  share: the layout of the shared memory segment holding U
+ *                  and the messages exchanged over the Unix domain socket.
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 06:04:11
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  agent (agent@local)
+ *
+ * ============================================================================
+ */
+
+#ifndef _QUERY_H_
+#define _QUERY_H_
+
+#define QUERY_DEFAULT_SOCKET    "/tmp/simdsrv.sock"
+#define QUERY_DEFAULT_SHM       "/simdsrv"
+
+// The available queries, all of them on U[i_start, i_end):
+//  - QUERY_FIND: the positions of val (in lo)
+//  - QUERY_COUNT: the number of occurences of val (in lo)
+//  - QUERY_RANGE: the positions of the elements between lo and hi
+#define QUERY_FIND      0
+#define QUERY_COUNT     1
+#define QUERY_RANGE     2
+
+// The status of a response
+#define QUERY_OK            0
+#define QUERY_BAD_REQUEST   1
+
+/**
+ * The shared memory segment starts with that header, U starts at
+ * QUERY_SHM_DATA_OFFSET bytes (so that it's 32 bytes aligned, mmap giving us
+ * page aligned segments).
+ */
+struct query_shm_header{
+    int n;
+    int a;
+    int b;
+};
+
+#define QUERY_SHM_DATA_OFFSET 64
+
+struct query_request{
+    int op;
+    int i_start;
+    int i_end;
+    int lo;
+    int hi;
+};
+
+/**
+ * A response is that header, followed by count ints (the positions) for
+ * QUERY_FIND and QUERY_RANGE.
+ */
+struct query_response{
+    int status;
+    int count;
+};
+
+#endif
@@ -0,0 +1,253 @@
+/*
+ * ============================================================================
+ *
+ *       Filename:  result.c
+ *
+ *    Description:  Implementation of the representations of the results of
+ *                  a search and of the conversions between them.
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 06:13:06
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  agent (agent@local)
+ *
+ * ============================================================================
+ */
+#include "result.h"
+
+#include <stdlib.h>
+
+#include "find.h"
+#include "find_auto.h"
+#include "utilities.h"
+
+/**
+ * The counterpart of estimate_selectivity for the proportion of the elements
+ * that start a run of matches, sampled on the same blocks.
+ */
+static float estimate_run_density(int *U, int i_start, int i_end, int i_step,
+                                  int val){
+    int n, b, start, c;
+
+    n = (i_end - i_start + i_step - 1) / i_step;
+
+    if(n <= 0)
+        return 0;
+
+    if(n <= FIND_AUTO_SAMPLE_BLOCKS * FIND_AUTO_SAMPLE_SIZE)
+        return (float) vect_count_runs(U, i_start, i_end, i_step, val) / n;
+
+    c = 0;
+    for(b = 0; b < FIND_AUTO_SAMPLE_BLOCKS; b++){
+        start = i_start + i_step * (int)((long) b * (n - FIND_AUTO_SAMPLE_SIZE)
+                                         / (FIND_AUTO_SAMPLE_BLOCKS - 1));
+        c += vect_count_runs(U, start,
+                             min(start + FIND_AUTO_SAMPLE_SIZE * i_step, i_end),
+                             i_step, val);
+    }
+
+    return (float) c / (FIND_AUTO_SAMPLE_BLOCKS * FIND_AUTO_SAMPLE_SIZE);
+}
+
+int choose_result_repr(int n, float selectivity, float run_density){
+    float indexes, bitmap, runs;
+
+    // What each representation would take, in bytes
+    indexes = 4 * selectivity * n;
+    bitmap = n / 8.0;
+    runs = 8 * run_density * n;
+
+    // The indexes are what everybody expects, they win the ties
+    if(indexes <= bitmap && indexes <= runs)
+        return RESULT_INDEXES;
+    if(runs < bitmap)
+        return RESULT_RUNS;
+    return RESULT_BITMAP;
+}
+
+int find_result(int *U, int i_start, int i_end, int i_step, int val, int repr,
+                struct find_result *res){
+    res->i_start = i_start;
+    res->i_step = i_step;
+    res->n = max((i_end - i_start + i_step - 1) / i_step, 0);
+    res->ind_val = NULL;
+    res->bitmap = NULL;
+    res->runs = NULL;
+    res->n_runs = 0;
+
+    if(repr == RESULT_AUTO)
+        repr = choose_result_repr(res->n,
+                    estimate_selectivity(U, i_start, i_end, i_step, val),
+                    estimate_run_density(U, i_start, i_end, i_step, val));
+
+    res->repr = repr;
+
+    switch(repr){
+        case RESULT_BITMAP:
+            res->bitmap = calloc(BITMAP_BYTES(res->n), sizeof(unsigned char));
+            res->count = vect_find_bitmap(U, i_start, i_end, i_step, val,
+                                          res->bitmap);
+            break;
+        case RESULT_RUNS:
+            // Counting the runs first, the same way as the two-pass
+            // thread_find, lets us allocate exactly what's needed
+            res->n_runs = vect_count_runs(U, i_start, i_end, i_step, val);
+            res->runs = malloc(max(2 * res->n_runs, 1) * sizeof(int));
+            res->count = vect_find_runs_fill(U, i_start, i_end, i_step, val,
+                                             res->runs, res->n_runs);
+            break;
+        default:
+            res->repr = RESULT_INDEXES;
+            res->count = find_auto(U, i_start, i_end, i_step, val,
+                                   &res->ind_val);
+    }
+
+    return res->count;
+}
+
+long result_bytes(const struct find_result *res){
+    switch(res->repr){
+        case RESULT_BITMAP:
+            return BITMAP_BYTES(res->n);
+        case RESULT_RUNS:
+            return 2 * sizeof(int) * (long) res->n_runs;
+        default:
+            return sizeof(int) * (long) res->count;
+    }
+}
+
+void result_free(struct find_result *res){
+    free(res->ind_val);
+    free(res->bitmap);
+    free(res->runs);
+    res->ind_val = NULL;
+    res->bitmap = NULL;
+    res->runs = NULL;
+}
+
+void result_iter_init(struct result_iter *it, const struct find_result *res){
+    it->res = res;
+    it->k = 0;
+    it->next = 0;
+    it->left = 0;
+    it->bits = 0;
+}
+
+int result_iter_next(struct result_iter *it, int *i){
+    const struct find_result *res = it->res;
+
+    switch(res->repr){
+        case RESULT_BITMAP:
+            // The empty bytes are skipped without looking at their bits
+            while(it->bits == 0){
+                if(it->k >= (res->n + 7) / 8)
+                    return 0;
+                it->bits = res->bitmap[it->k];
+                it->next = 8 * it->k;
+                it->k++;
+            }
+            *i = res->i_start + res->i_step *
+                                (it->next + __builtin_ctz(it->bits));
+            it->bits &= it->bits - 1;
+            return 1;
+        case RESULT_RUNS:
+            if(it->left == 0){
+                if(it->k >= res->n_runs)
+                    return 0;
+                it->next = res->runs[2 * it->k];
+                it->left = res->runs[2 * it->k + 1];
+                it->k++;
+            }
+            *i = it->next;
+            it->next += res->i_step;
+            it->left--;
+            return 1;
+        default:
+            if(it->k >= res->count)
+                return 0;
+            *i = res->ind_val[it->k++];
+            return 1;
+    }
+}
+
+/**
+ * The number of runs of consecutive matches of res.
+ */
+static int count_runs(const struct find_result *res){
+    int i, prev = 0, c = 0;
+    struct result_iter it;
+
+    if(res->repr == RESULT_RUNS)
+        return res->n_runs;
+
+    result_iter_init(&it, res);
+    while(result_iter_next(&it, &i)){
+        if(c == 0 || i != prev + res->i_step)
+            c++;
+        prev = i;
+    }
+
+    return c;
+}
+
+void result_convert(struct find_result *res, int repr){
+    int i, c, slot, n_runs;
+    struct result_iter it;
+    struct find_result conv = *res;
+
+    n_runs = count_runs(res);
+
+    // Now we know the actual densities, not estimates
+    if(repr == RESULT_AUTO)
+        repr = choose_result_repr(res->n, (float) res->count / max(res->n, 1),
+                                  (float) n_runs / max(res->n, 1));
+
+    if(repr == res->repr)
+        return;
+
+    conv.repr = repr;
+    conv.ind_val = NULL;
+    conv.bitmap = NULL;
+    conv.runs = NULL;
+    conv.n_runs = 0;
+
+    switch(repr){
+        case RESULT_BITMAP:
+            conv.bitmap = calloc(BITMAP_BYTES(res->n), sizeof(unsigned char));
+            break;
+        case RESULT_RUNS:
+            conv.runs = malloc(max(2 * n_runs, 1) * sizeof(int));
+            break;
+        default:
+            conv.ind_val = malloc(max(res->count, 1) * sizeof(int));
+    }
+
+    c = 0;
+    result_iter_init(&it, res);
+    while(result_iter_next(&it, &i)){
+        switch(repr){
+            case RESULT_BITMAP:
+                slot = (i - res->i_start) / res->i_step;
+                conv.bitmap[slot / 8] |= 1 << (slot % 8);
+                break;
+            case RESULT_RUNS:
+                if(conv.n_runs > 0 &&
+                   i == conv.runs[2 * conv.n_runs - 2] +
+                        res->i_step * conv.runs[2 * conv.n_runs - 1])
+                    conv.runs[2 * conv.n_runs - 1]++;
+                else {
+                    conv.runs[2 * conv.n_runs] = i;
+                    conv.runs[2 * conv.n_runs + 1] = 1;
+                    conv.n_runs++;
+                }
+                break;
+            default:
+                conv.ind_val[c++] = i;
+        }
+    }
+
+    result_free(res);
+    *res = conv;
+}
@@ -0,0 +1,112 @@
+/*
+ * ============================================================================
+ *
+ *       Filename:  result.h
+ *
+ *    Description:  The different ways the matches of a search can be handed
+ *                  back (a list of indexes, a bitmap or runs of consecutive
+ *                  matches), the choice of the smallest one from the sampled
+ *                  density of the matches and iterators to go from one to
+ *                  another.
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 06:13:06
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  agent (agent@local)
+ *
+ * ============================================================================
+ */
+
+#ifndef _RESULT_H_
+#define _RESULT_H_
+
+// The representations of a result:
+//  - RESULT_INDEXES: the usual ind_val array, 4 bytes per match
+//  - RESULT_BITMAP: one bit per element looked at, whatever the number of
+//    matches (vect_find_bitmap)
+//  - RESULT_RUNS: 8 bytes per run of consecutive matches, great when the
+//    matches come in clusters (vect_find_runs_fill)
+//  - RESULT_AUTO: the smallest of the three, from the estimated number of
+//    matches and of runs
+#define RESULT_INDEXES  0
+#define RESULT_BITMAP   1
+#define RESULT_RUNS     2
+#define RESULT_AUTO     3
+
+/**
+ * The matches of a search of [i_start, i_end) with a step of i_step, which
+ * looked at n elements. count is their number whatever the representation,
+ * only the fields of repr are set:
+ *  - ind_val: the count indexes of the matches
+ *  - bitmap: bit j is set iff i_start + j * i_step is a match
+ *  - runs: n_runs pairs of ints, the index of the first match of a run and
+ *    the number of matches in it
+ */
+struct find_result{
+    int repr;
+    int count;
+    int i_start;
+    int i_step;
+    int n;
+    int *ind_val;
+    unsigned char *bitmap;
+    int *runs;
+    int n_runs;
+};
+
+/**
+ * Returns the RESULT_* taking the least memory for the matches of n elements,
+ * given the proportion of them expected to be matches (selectivity) and to
+ * start a run (run_density).
+ */
+int choose_result_repr(int n, float selectivity, float run_density);
+
+/**
+ * Looks for val in U between the indexes i_start and i_end (with a step of
+ * i_step) and puts its matches in res, in the repr representation. Returns
+ * their number.
+ */
+int find_result(int *U, int i_start, int i_end, int i_step, int val, int repr,
+                struct find_result *res);
+
+/**
+ * The number of bytes the matches take in their current representation.
+ */
+long result_bytes(const struct find_result *res);
+
+void result_free(struct find_result *res);
+
+/**
+ * Walks through the indexes of the matches of a result in increasing order,
+ * whatever its representation:
+ *
+ *   struct result_iter it;
+ *   result_iter_init(&it, &res);
+ *   while(result_iter_next(&it, &i)){
+ *       // i is the index of a match
+ *   }
+ */
+struct result_iter{
+    const struct find_result *res;
+    // The next entry of ind_val, run or byte of the bitmap to look at
+    int k;
+    // In the current run: the next match and how many are left. In the
+    // current byte of the bitmap: the slot of its bit 0 and the bits left.
+    int next;
+    int left;
+    unsigned int bits;
+};
+
+void result_iter_init(struct result_iter *it, const struct find_result *res);
+
+int result_iter_next(struct result_iter *it, int *i);
+
+/**
+ * Changes the representation of res to repr (RESULT_AUTO picking the smallest
+ * one for the actual matches).
+ */
+void result_convert(struct find_result *res, int repr);
+
+#endif
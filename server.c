@@ -0,0 +1,545 @@
+/*
+ * ============================================================================
+ *
+ *       Filename:  server.c
+ *
+ *    Description:  simdsrv, a long-lived process keeping U resident in a
+ *                  POSIX shared memory segment (that other local processes
+ *                  can map) and answering find, count and range queries over
+ *                  a Unix domain socket. All the queries received while a
+ *                  batch is being run are answered together by the next one,
+ *                  in shared passes over U (see thread_find_batch).
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 06:04:11
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  agent (agent@local)
+ *
+ * ============================================================================
+ */
+
+#define _XOPEN_SOURCE 600
+
+// Standard library
+#include <argp.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Unix-specific standard library
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Project
+#include "colors.h"
+#include "query.h"
+#include "thread_find.h"
+#include "trace.h"
+#include "utilities.h"
+
+// The maximum number of simultaneously connected clients
+#define MAX_CLIENTS 1024
+
+/**
+ * A connected client. Its socket is non-blocking: a request may come in
+ * several reads and a response go out in several writes, so both are buffered
+ * here until they're complete. We don't read a new request from a client
+ * before its previous response has been sent.
+ */
+struct client{
+    int fd;
+    // The request being received, req_len bytes of it so far
+    struct query_request req;
+    size_t req_len;
+    // The response being sent (NULL if none), out_sent of its out_len bytes
+    // so far
+    char *out;
+    size_t out_len;
+    size_t out_sent;
+};
+
+struct server_arguments{
+    int n;
+    int a;
+    int b;
+    int threads;
+    int max_batch;
+    char *socket_path;
+    char *shm_name;
+};
+
+// Set by SIGINT/SIGTERM, the main loop then cleans everything up
+static volatile sig_atomic_t stop = 0;
+
+static void handle_signal(int sig){
+    (void) sig;
+    stop = 1;
+}
+
+//-----------------------------------------------------------------------------
+// CLI arguments
+//-----------------------------------------------------------------------------
+static char doc[] = "Keeps a randomly generated array resident in shared "
+                    "memory and answers find, count and range queries over a "
+                    "Unix domain socket.";
+static char args_doc[] = "";
+static struct argp_option options[] = {
+    { "size", 'n', "COUNT", 0, "The size of the array of generated random "
+        "integers (default: 100,000,000)."},
+    { "min", 'a', "COUNT", 0, "The smallest int of the randomly generated "
+        "range of ints (default: 0)"},
+    { "max", 'b', "COUNT", 0, "The highest int of the randomly generated "
+        "range of ints (default: 100)"},
+    { "threads", 't', "COUNT", 0, "The number of threads running every batch "
+        "(default: one per core)."},
+    { "max-batch", 'm', "COUNT", 0, "The maximum number of queries answered "
+        "by a single pass over the array (default: 256)."},
+    { "socket", 's', "PATH", 0, "The path of the Unix domain socket "
+        "(default: " QUERY_DEFAULT_SOCKET ")."},
+    { "shm", 'S', "NAME", 0, "The name of the shared memory segment "
+        "(default: " QUERY_DEFAULT_SHM ")."},
+    { 0 }
+};
+
+static error_t parse_opt(int key, char *arg, struct argp_state *state){
+    struct server_arguments *arguments = state->input;
+    switch (key) {
+        case 'n': arguments->n = atoi(arg); break;
+        case 'a': arguments->a = atoi(arg); break;
+        case 'b': arguments->b = atoi(arg); break;
+        case 't': arguments->threads = atoi(arg); break;
+        case 'm': arguments->max_batch = max(atoi(arg), 1); break;
+        case 's': arguments->socket_path = arg; break;
+        case 'S': arguments->shm_name = arg; break;
+        case ARGP_KEY_ARG: return 0;
+        default: return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+static struct argp argp = { options, parse_opt, args_doc, doc };
+
+//-----------------------------------------------------------------------------
+// Setup
+//-----------------------------------------------------------------------------
+
+/**
+ * Creates the shared memory segment, fills it with n random ints between a
+ * and b and returns its header (U being QUERY_SHM_DATA_OFFSET bytes after).
+ */
+static struct query_shm_header* create_shm(const char *name, int n, int a,
+                                           int b, size_t *size){
+    int fd;
+    struct query_shm_header *header;
+
+    // A previous server may have left its segment behind. Its clients keep
+    // their mapping, we just make sure never to write into it.
+    shm_unlink(name);
+
+    fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if(fd < 0){
+        perror("shm_open");
+        return NULL;
+    }
+
+    *size = QUERY_SHM_DATA_OFFSET + sizeof(int) * (size_t) n;
+    if(ftruncate(fd, *size) < 0){
+        perror("ftruncate");
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+
+    header = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(header == MAP_FAILED){
+        perror("mmap");
+        shm_unlink(name);
+        return NULL;
+    }
+
+    fill_array((int*)((char*) header + QUERY_SHM_DATA_OFFSET), n, a, b);
+
+    // Clients wait for n, which is only set once U is ready
+    header->a = a;
+    header->b = b;
+    __sync_synchronize();
+    header->n = n;
+
+    return header;
+}
+
+static int create_socket(const char *path){
+    int fd;
+    struct sockaddr_un addr;
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0){
+        perror("socket");
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(struct sockaddr_un));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    // A previous server may have left its socket behind
+    unlink(path);
+
+    if(bind(fd, (struct sockaddr*) &addr, sizeof(struct sockaddr_un)) < 0 ||
+       listen(fd, MAX_CLIENTS) < 0){
+        perror("bind/listen");
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+//-----------------------------------------------------------------------------
+// Queries
+//-----------------------------------------------------------------------------
+
+/**
+ * Turns a request into a query of a batch. Returns QUERY_OK or
+ * QUERY_BAD_REQUEST if it doesn't make sense.
+ */
+static int to_find_query(struct query_request *req, int n,
+                         struct find_query *query){
+    if(req->i_start < 0 || req->i_end > n || req->i_start > req->i_end)
+        return QUERY_BAD_REQUEST;
+
+    query->i_start = req->i_start;
+    query->i_end = req->i_end;
+    query->lo = req->lo;
+
+    switch(req->op){
+        case QUERY_FIND:
+            query->hi = req->lo;
+            query->want_positions = 1;
+            break;
+        case QUERY_COUNT:
+            query->hi = req->lo;
+            query->want_positions = 0;
+            break;
+        case QUERY_RANGE:
+            query->hi = req->hi;
+            query->want_positions = 1;
+            break;
+        default:
+            return QUERY_BAD_REQUEST;
+    }
+
+    return QUERY_OK;
+}
+
+//-----------------------------------------------------------------------------
+// Clients
+//-----------------------------------------------------------------------------
+
+/**
+ * Whether the operation on a non-blocking socket that failed just has to be
+ * tried again later.
+ */
+static int try_again(void){
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+static void close_client(struct client *cl){
+    close(cl->fd);
+    cl->fd = -1;
+    free(cl->out);
+    cl->out = NULL;
+}
+
+/**
+ * Reads what the client has sent of its request. Returns -1 if it went away.
+ */
+static int receive_request(struct client *cl){
+    ssize_t r;
+
+    r = read(cl->fd, (char*) &cl->req + cl->req_len,
+             sizeof(struct query_request) - cl->req_len);
+    if(r < 0 && try_again())
+        return 0;
+    if(r <= 0)
+        return -1;
+
+    cl->req_len += r;
+
+    return 0;
+}
+
+/**
+ * Writes as much of the pending response as the socket takes. Returns -1 if
+ * the client went away.
+ */
+static int send_pending(struct client *cl){
+    ssize_t r;
+
+    while(cl->out_sent < cl->out_len){
+        r = write(cl->fd, cl->out + cl->out_sent, cl->out_len - cl->out_sent);
+        if(r < 0 && try_again())
+            return 0;
+        if(r <= 0)
+            return -1;
+        cl->out_sent += r;
+    }
+
+    // All sent, on to the next request
+    free(cl->out);
+    cl->out = NULL;
+    cl->req_len = 0;
+
+    return 0;
+}
+
+/**
+ * Queues the response to a query and sends what can be sent of it right away.
+ * Returns -1 if the client went away.
+ */
+static int send_response(struct client *cl, int status,
+                         struct find_query *query){
+    struct query_response res;
+    size_t positions_len = 0;
+
+    res.status = status;
+    res.count = (status == QUERY_OK) ? query->count : 0;
+
+    if(status == QUERY_OK && query->want_positions)
+        positions_len = sizeof(int) * query->count;
+
+    cl->out_len = sizeof(struct query_response) + positions_len;
+    cl->out_sent = 0;
+    cl->out = malloc(cl->out_len);
+    memcpy(cl->out, &res, sizeof(struct query_response));
+    if(positions_len > 0)
+        memcpy(cl->out + sizeof(struct query_response), query->ind_val,
+               positions_len);
+
+    return send_pending(cl);
+}
+
+int main(int argc, char **argv){
+    int listen_fd, fd, n_clients, n_ready, n_batch, first, next, i, j, k;
+    int lo, hi, n;
+    int *U, *statuses, *batch_clients;
+    long n_queries, n_batches;
+    size_t shm_size;
+    struct server_arguments arguments;
+    struct query_shm_header *header;
+    struct find_query *queries, *valid;
+    struct client *clients, *cl;
+    struct pollfd *fds;
+    struct sigaction sa;
+
+    arguments.n = 100000000;
+    arguments.a = 0;
+    arguments.b = 100;
+    arguments.threads = 0;
+    arguments.max_batch = 256;
+    arguments.socket_path = QUERY_DEFAULT_SOCKET;
+    arguments.shm_name = QUERY_DEFAULT_SHM;
+
+    argp_parse(&argp, argc, argv, 0, 0, &arguments);
+
+    n = arguments.n;
+    set_number_of_threads(arguments.threads);
+
+    // fill_array goes on with the current rand() stream
+    srand(time(NULL));
+
+    printf(ANSI_STYLE_BOLD "  [*] Generating U (%d ints between %d and %d) in "
+           "the shared memory segment %s\n" ANSI_STYLE_NO_BOLD, n,
+           arguments.a, arguments.b, arguments.shm_name);
+
+    header = create_shm(arguments.shm_name, n, arguments.a, arguments.b,
+                        &shm_size);
+    if(header == NULL)
+        return 1;
+    U = (int*)((char*) header + QUERY_SHM_DATA_OFFSET);
+
+    listen_fd = create_socket(arguments.socket_path);
+    if(listen_fd < 0){
+        munmap(header, shm_size);
+        shm_unlink(arguments.shm_name);
+        return 2;
+    }
+
+    // No SA_RESTART: we want poll to give up when we're asked to stop. And a
+    // client leaving while we answer it mustn't kill us.
+    memset(&sa, 0, sizeof(struct sigaction));
+    sa.sa_handler = &handle_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    printf(ANSI_STYLE_BOLD "  [*] Listening on %s\n" ANSI_STYLE_NO_BOLD,
+           arguments.socket_path);
+    fflush(stdout);
+
+    fds = malloc((MAX_CLIENTS + 1) * sizeof(struct pollfd));
+    clients = malloc(MAX_CLIENTS * sizeof(struct client));
+    queries = malloc(arguments.max_batch * sizeof(struct find_query));
+    valid = malloc(arguments.max_batch * sizeof(struct find_query));
+    statuses = malloc(arguments.max_batch * sizeof(int));
+    batch_clients = malloc(arguments.max_batch * sizeof(int));
+
+    n_clients = 0;
+    n_ready = 0;
+    first = 0;
+    n_queries = 0;
+    n_batches = 0;
+
+    while(!stop){
+        // fds[i + 1] is the socket of clients[i]: we wait for the rest of its
+        // request, or for room to send the rest of its response
+        fds[0].fd = listen_fd;
+        fds[0].events = POLLIN;
+        for(i = 0; i < n_clients; i++){
+            fds[i + 1].fd = clients[i].fd;
+            if(clients[i].out != NULL)
+                fds[i + 1].events = POLLOUT;
+            else if(clients[i].req_len < sizeof(struct query_request))
+                fds[i + 1].events = POLLIN;
+            else
+                fds[i + 1].events = 0;
+        }
+
+        // The complete requests that didn't fit in the last batch mustn't
+        // wait for some more activity on the sockets
+        if(poll(fds, n_clients + 1, n_ready > 0 ? 0 : -1) < 0){
+            if(errno == EINTR)
+                continue;
+            perror("poll");
+            break;
+        }
+
+        for(i = 0; i < n_clients; i++){
+            cl = &clients[i];
+
+            if(fds[i + 1].revents & (POLLHUP | POLLERR | POLLNVAL) &&
+               !(fds[i + 1].revents & POLLIN))
+                close_client(cl);
+            else if(fds[i + 1].revents & POLLOUT && send_pending(cl) < 0)
+                close_client(cl);
+            else if(fds[i + 1].revents & POLLIN && receive_request(cl) < 0)
+                close_client(cl);
+        }
+
+        if(fds[0].revents & POLLIN){
+            fd = accept(listen_fd, NULL, NULL);
+            if(fd >= 0 && n_clients < MAX_CLIENTS &&
+               fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == 0){
+                cl = &clients[n_clients++];
+                cl->fd = fd;
+                cl->req_len = 0;
+                cl->out = NULL;
+            } else if(fd >= 0)
+                close(fd);
+        }
+
+        // Every client with a complete request gets into the batch (the ones
+        // that don't fit will be in the next one). We start where the last
+        // batch stopped, so that the first clients can't starve the others.
+        n_batch = 0;
+        n_ready = 0;
+        next = first;
+        for(k = 0; k < n_clients; k++){
+            i = (first + k) % n_clients;
+            cl = &clients[i];
+            if(cl->fd < 0 || cl->out != NULL ||
+               cl->req_len < sizeof(struct query_request))
+                continue;
+
+            if(n_batch == arguments.max_batch){
+                n_ready++;
+                continue;
+            }
+
+            batch_clients[n_batch] = i;
+            statuses[n_batch] = to_find_query(&cl->req, n, &queries[n_batch]);
+            n_batch++;
+            next = i + 1;
+        }
+        first = next;
+
+        if(n_batch > 0){
+            // The valid queries only, over the smallest range covering them
+            j = 0;
+            lo = n;
+            hi = 0;
+            for(i = 0; i < n_batch; i++){
+                if(statuses[i] != QUERY_OK)
+                    continue;
+                valid[j++] = queries[i];
+                lo = min(lo, queries[i].i_start);
+                hi = max(hi, queries[i].i_end);
+            }
+
+            if(j > 0){
+                TRACE_BEGIN(t_batch);
+                thread_find_batch(U, lo, max(lo, hi), valid, j);
+                TRACE_END(t_batch, "batch");
+            }
+
+            j = 0;
+            for(i = 0; i < n_batch; i++){
+                if(statuses[i] == QUERY_OK)
+                    queries[i] = valid[j++];
+
+                if(send_response(&clients[batch_clients[i]], statuses[i],
+                                 &queries[i]) < 0)
+                    close_client(&clients[batch_clients[i]]);
+
+                if(statuses[i] == QUERY_OK)
+                    free(queries[i].ind_val);
+            }
+
+            n_queries += n_batch;
+            n_batches++;
+        }
+
+        // Let's forget about the clients that left (first being shifted
+        // along with the clients after it)
+        for(i = 0, j = 0, k = first; i < n_clients; i++){
+            if(clients[i].fd >= 0)
+                clients[j++] = clients[i];
+            else if(i < k)
+                first--;
+        }
+        n_clients = j;
+    }
+
+    printf(ANSI_STYLE_BOLD "\n  [*] Served %ld queries in %ld batches "
+           "(%.1f queries per batch)\n" ANSI_STYLE_NO_BOLD, n_queries,
+           n_batches, n_batches ? (float) n_queries / n_batches : 0.0);
+
+    // Only with make TRACE=1
+    TRACE_EXPORT("simdsrv_trace.json");
+
+    for(i = 0; i < n_clients; i++)
+        close_client(&clients[i]);
+    close(listen_fd);
+    unlink(arguments.socket_path);
+    munmap(header, shm_size);
+    shm_unlink(arguments.shm_name);
+
+    free(fds);
+    free(clients);
+    free(queries);
+    free(valid);
+    free(statuses);
+    free(batch_clients);
+
+    return 0;
+}
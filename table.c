@@ -0,0 +1,275 @@
+/*
+ * ============================================================================
+ *
+ *       Filename:  table.c
+ *
+ *    Description:  Implementation of our tables and of their scans against
+ *                  conjunctions of predicates.
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 06:23:45
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  agent (agent@local)
+ *
+ * ============================================================================
+ */
+
+// posix_memalign
+#define _XOPEN_SOURCE 600
+
+#include "table.h"
+
+#include <stdlib.h>
+
+#include "utilities.h"
+#include "vect_utils.h"
+
+// The first size of the result arrays of table_find and vect_table_find
+#define TABLE_FIND_INITIAL_SIZE 64
+
+struct table* table_create(int **columns, int n_columns, int n){
+    int k, j, i;
+    struct table *tab;
+
+    tab = malloc(sizeof(struct table));
+    tab->n = n;
+    tab->n_columns = n_columns;
+    tab->n_blocks = (n + TABLE_BLOCK - 1) / TABLE_BLOCK;
+
+    tab->columns = malloc(n_columns * sizeof(int*));
+    tab->block_min = malloc(n_columns * sizeof(int*));
+    tab->block_max = malloc(n_columns * sizeof(int*));
+
+    for(k = 0; k < n_columns; k++){
+        tab->columns[k] = columns[k];
+        tab->block_min[k] = malloc(max(tab->n_blocks, 1) * sizeof(int));
+        tab->block_max[k] = malloc(max(tab->n_blocks, 1) * sizeof(int));
+
+        for(j = 0; j < tab->n_blocks; j++){
+            tab->block_min[k][j] = columns[k][j * TABLE_BLOCK];
+            tab->block_max[k][j] = columns[k][j * TABLE_BLOCK];
+            for(i = j * TABLE_BLOCK; i < min(n, (j + 1) * TABLE_BLOCK); i++){
+                tab->block_min[k][j] = min(tab->block_min[k][j],
+                                           columns[k][i]);
+                tab->block_max[k][j] = max(tab->block_max[k][j],
+                                           columns[k][i]);
+            }
+        }
+    }
+
+    return tab;
+}
+
+void table_free(struct table *tab){
+    int k;
+
+    for(k = 0; k < tab->n_columns; k++){
+        free(tab->block_min[k]);
+        free(tab->block_max[k]);
+    }
+
+    free(tab->columns);
+    free(tab->block_min);
+    free(tab->block_max);
+    free(tab);
+}
+
+int table_find(struct table *tab, int i_start, int i_end,
+               struct predicate *preds, int n_preds, int **ind_val){
+    int i, k, size, v;
+    int c = 0;
+
+    size = TABLE_FIND_INITIAL_SIZE;
+    (*ind_val) = malloc(size * sizeof(int));
+
+    for(i = i_start; i < i_end; i++){
+        for(k = 0; k < n_preds; k++){
+            v = tab->columns[preds[k].column][i];
+            if(v < preds[k].lo || v > preds[k].hi)
+                break;
+        }
+
+        if(k == n_preds)
+            append_index(ind_val, &size, c++, i);
+    }
+
+    (*ind_val) = realloc((*ind_val), max(c, 1) * sizeof(int));
+
+    return c;
+}
+
+//-----------------------------------------------------------------------------
+// The vectorial scans
+//-----------------------------------------------------------------------------
+
+/**
+ * Walks through the rows of [i_start, i_end) matching all the predicates, by
+ * blocks of 8 rows:
+ *
+ *   struct table_scan ts;
+ *   table_scan_init(&ts, tab, i_start, i_end, preds, n_preds);
+ *   while(table_scan_next(&ts, &base, &mask)){
+ *       // row base + j matches iff bit j of mask is set (never 0)
+ *   }
+ *
+ * The rows are walked through one block of TABLE_BLOCK at a time, the blocks
+ * that can't hold any match being skipped as a whole. The first predicate
+ * drives a vect_scan of its column, the next ones only load the lanes of
+ * their column that are still set in the mask.
+ */
+struct table_scan{
+    struct table *tab;
+    struct predicate *preds;
+    int n_preds;
+    // The next row of the next block of TABLE_BLOCK, and where we stop
+    int i;
+    int i_end;
+    // The scan of the current block, if it's not skipped
+    struct vect_scan sc;
+    int scanning;
+    __m256i *lo_vect;
+    __m256i *hi_vect;
+};
+
+VECT_INLINE void table_scan_init(struct table_scan *ts, struct table *tab,
+                                 int i_start, int i_end,
+                                 struct predicate *preds, int n_preds){
+    int k;
+
+    ts->tab = tab;
+    ts->preds = preds;
+    ts->n_preds = n_preds;
+    ts->i = i_start;
+    ts->i_end = i_end;
+    ts->scanning = 0;
+
+    posix_memalign((void**) &ts->lo_vect, 32, n_preds * sizeof(__m256i));
+    posix_memalign((void**) &ts->hi_vect, 32, n_preds * sizeof(__m256i));
+    for(k = 0; k < n_preds; k++){
+        ts->lo_vect[k] = _mm256_set1_epi32(preds[k].lo);
+        ts->hi_vect[k] = _mm256_set1_epi32(preds[k].hi);
+    }
+}
+
+VECT_INLINE void table_scan_free(struct table_scan *ts){
+    free(ts->lo_vect);
+    free(ts->hi_vect);
+}
+
+/**
+ * Whether all the predicates may hold on some row of the block j.
+ */
+VECT_INLINE int block_may_match(struct table *tab, struct predicate *preds,
+                                int n_preds, int j){
+    int k;
+
+    for(k = 0; k < n_preds; k++){
+        if(preds[k].hi < tab->block_min[preds[k].column][j] ||
+           preds[k].lo > tab->block_max[preds[k].column][j])
+            return 0;
+    }
+
+    return 1;
+}
+
+VECT_INLINE int table_scan_next(struct table_scan *ts, int *base,
+                                unsigned int *mask){
+    int k, block_end;
+    unsigned int lanes;
+
+    __m256i v __attribute__ ((aligned(32)));
+
+    for(;;){
+        while(ts->scanning && vect_scan_next(&ts->sc, base, &v, &lanes)){
+            *mask = vect_range_mask(v, ts->lo_vect[0], ts->hi_vect[0]) & lanes;
+
+            // Every lane already ruled out is one less element of the next
+            // columns to load
+            for(k = 1; k < ts->n_preds && *mask; k++){
+                v = vect_load_lanes(&ts->sc.st,
+                                    ts->tab->columns[ts->preds[k].column],
+                                    *base, *mask);
+                *mask &= vect_range_mask(v, ts->lo_vect[k], ts->hi_vect[k]);
+            }
+
+            if(*mask)
+                return 1;
+        }
+
+        if(ts->i >= ts->i_end)
+            return 0;
+
+        // On to the next block of TABLE_BLOCK rows (or what's left of it)
+        block_end = min(ts->i_end, (ts->i / TABLE_BLOCK + 1) * TABLE_BLOCK);
+        ts->scanning = block_may_match(ts->tab, ts->preds, ts->n_preds,
+                                       ts->i / TABLE_BLOCK);
+        if(ts->scanning)
+            vect_scan_init(&ts->sc, ts->tab->columns[ts->preds[0].column],
+                           ts->i, block_end, 1);
+        ts->i = block_end;
+    }
+}
+
+int vect_table_find(struct table *tab, int i_start, int i_end,
+                    struct predicate *preds, int n_preds, int **ind_val){
+    int base, size;
+    int c = 0;
+    unsigned int mask;
+    struct table_scan ts;
+
+    size = TABLE_FIND_INITIAL_SIZE;
+    (*ind_val) = malloc(size * sizeof(int));
+
+    // Nothing but masks until here: the indexes of the rows only get written
+    // once all the predicates agree on them
+    table_scan_init(&ts, tab, i_start, i_end, preds, n_preds);
+    while(table_scan_next(&ts, &base, &mask)){
+        while(mask){
+            append_index(ind_val, &size, c++, base + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+    table_scan_free(&ts);
+
+    (*ind_val) = realloc((*ind_val), max(c, 1) * sizeof(int));
+
+    return c;
+}
+
+int vect_table_count(struct table *tab, int i_start, int i_end,
+                     struct predicate *preds, int n_preds){
+    int base;
+    int c = 0;
+    unsigned int mask;
+    struct table_scan ts;
+
+    table_scan_init(&ts, tab, i_start, i_end, preds, n_preds);
+    while(table_scan_next(&ts, &base, &mask)){
+        c += __builtin_popcount(mask);
+    }
+    table_scan_free(&ts);
+
+    return c;
+}
+
+int vect_table_find_fill(struct table *tab, int i_start, int i_end,
+                         struct predicate *preds, int n_preds, int *ind_val,
+                         int max_c){
+    int base;
+    int c = 0;
+    unsigned int mask;
+    struct table_scan ts;
+
+    table_scan_init(&ts, tab, i_start, i_end, preds, n_preds);
+    while(c < max_c && table_scan_next(&ts, &base, &mask)){
+        while(mask && c < max_c){
+            ind_val[c++] = base + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+    table_scan_free(&ts);
+
+    return c;
+}
@@ -0,0 +1,88 @@
+/*
+ * ============================================================================
+ *
+ *       Filename:  table.h
+ *
+ *    Description:  Several aligned int columns (a structure of arrays) and
+ *                  their scan against a conjunction of predicates such as
+ *                  "colA == x AND colB in [lo, hi]": the predicates are
+ *                  evaluated column by column into SIMD masks and the indexes
+ *                  of the matching rows only materialized at the very end.
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 06:23:45
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  agent (agent@local)
+ *
+ * ============================================================================
+ */
+
+#ifndef _TABLE_H_
+#define _TABLE_H_
+
+// The number of rows summarized by each block_min/block_max entry
+#define TABLE_BLOCK 4096
+
+/**
+ * columns[k][i] is the value of the column k on the row i, for i < n. The
+ * table doesn't own the columns (the arrays we generated or loaded), only
+ * their summaries: block_min[k][j] and block_max[k][j] bound the values of
+ * the column k on the rows [j * TABLE_BLOCK, (j + 1) * TABLE_BLOCK).
+ */
+struct table{
+    int n;
+    int n_columns;
+    int **columns;
+    int n_blocks;
+    int **block_min;
+    int **block_max;
+};
+
+/**
+ * lo <= columns[column][i] <= hi, an equality being lo = hi.
+ */
+struct predicate{
+    int column;
+    int lo;
+    int hi;
+};
+
+/**
+ * Builds a table over the n_columns arrays of columns, n rows each.
+ */
+struct table* table_create(int **columns, int n_columns, int n);
+
+void table_free(struct table *tab);
+
+/**
+ * Looks for the rows of [i_start, i_end) matching all of the n_preds (>= 1)
+ * predicates, one row and one predicate at a time. Returns their number and
+ * puts their indexes in *ind_val, like find does.
+ */
+int table_find(struct table *tab, int i_start, int i_end,
+               struct predicate *preds, int n_preds, int **ind_val);
+
+/**
+ * The vectorial counterpart of table_find. The rows of a block of TABLE_BLOCK
+ * that one of the predicates rules out as a whole (from the block summaries)
+ * aren't looked at at all. Otherwise, every 8 rows, the first predicate gives
+ * a mask that the next ones narrow down, and a column is only loaded while
+ * that mask has bits left: put the most selective predicates first.
+ */
+int vect_table_find(struct table *tab, int i_start, int i_end,
+                    struct predicate *preds, int n_preds, int **ind_val);
+
+/**
+ * The two passes of vect_table_find, as vect_count and vect_find_fill are
+ * those of vect_find.
+ */
+int vect_table_count(struct table *tab, int i_start, int i_end,
+                     struct predicate *preds, int n_preds);
+
+int vect_table_find_fill(struct table *tab, int i_start, int i_end,
+                         struct predicate *preds, int n_preds, int *ind_val,
+                         int max_c);
+
+#endif
@@ -18,6 +18,11 @@
  *
  * ============================================================================
  */
+
+// pthread barriers are a POSIX 2001 addition, we need to ask for them before
+// anything gets included
+#define _XOPEN_SOURCE 600
+
 #include "thread_find.h"
 
 #include <pthread.h>
@@ -27,20 +32,31 @@
 #include <stdio.h>
 
 #include "find.h"
+#include "find_auto.h"
+#include "trace.h"
+#include "table.h"
 #include "utilities.h"
+#include "value_set.h"
+#include "vect_utils.h"
 
 // Note that we perform the mutex unlocking operation ASAP here in order to
-// minimize the waiting time for potentially blocked threads.
+// minimize the waiting time for potentially blocked threads. (The scan of the
+// calling thread, t_scan, ends here when k is reached.)
 #define test_U_j_with_gc(j) \
     if(U[j] == val){ \
+        TRACE_BEGIN(t_lock); \
         pthread_mutex_lock(&gc_lock); \
+        TRACE_END(t_lock, "lock wait"); \
         if(*gc >= mgc){ \
             pthread_mutex_unlock(&gc_lock); \
+            TRACE_END(t_scan, "scan"); \
             pthread_exit((void*) c); \
         } \
         (*gc)++; \
         pthread_mutex_unlock(&gc_lock); \
+        TRACE_BEGIN(t_realloc); \
         (*ind_val) = realloc((*ind_val), (*c + 1)*sizeof(int)); \
+        TRACE_END(t_realloc, "realloc"); \
         (*ind_val)[*c] = j; \
         (*c)++; \
      }
@@ -52,6 +68,9 @@ int mgc;
 // A mutex for *gc access
 pthread_mutex_t gc_lock;
 
+// The number of threads to launch (0 means one per core)
+static int forced_n_threads = 0;
+
 struct thread_data{
     int *U;
     int i_start;
@@ -61,6 +80,102 @@ struct thread_data{
     int **ind_val;
 };
 
+// The two passes of a two-pass search over the chunk [i_start, i_end) of the
+// thread id, arg being whatever the search needs: count returns the number of
+// matches in the chunk, fill writes the positions of (at most max_c of) them
+// into ind_val
+typedef int (*two_pass_count_fn)(void *arg, int id, int i_start, int i_end);
+typedef void (*two_pass_fill_fn)(void *arg, int id, int i_start, int i_end,
+                                 int *ind_val, int max_c);
+
+// What the threads of a two-pass search share: the count of each chunk, the
+// offset where each chunk has to write its positions in the final array, and
+// the barrier on which they wait for each other in between.
+struct two_pass_data{
+    int n_threads;
+    int k;
+    two_pass_count_fn count;
+    two_pass_fill_fn fill;
+    void *arg;
+    int *counts;
+    int *offsets;
+    int total;
+    int **ind_val;
+    pthread_barrier_t barrier;
+};
+
+struct two_pass_thread_data{
+    int i_start;
+    int i_end;
+    int id;
+    struct two_pass_data *shared;
+};
+
+// The arg of the two passes of thread_find, sub_counts[id] being the counts
+// of the sub-chunks of the thread id with THREAD_FIND_AUTO
+struct find_two_pass_args{
+    int *U;
+    int i_step;
+    int val;
+    int ver;
+    int **sub_counts;
+};
+
+// The same for thread_find_batch: counts and offsets are n_threads rows of
+// n_queries columns
+struct batch_data{
+    int n_threads;
+    struct find_query *queries;
+    int n_queries;
+    int *counts;
+    int *offsets;
+    pthread_barrier_t barrier;
+};
+
+struct batch_thread_data{
+    int *U;
+    int i_start;
+    int i_end;
+    int id;
+    struct batch_data *shared;
+};
+
+// Every thread of thread_histogram fills its own row of hists (b - a + 1
+// ints each), every thread of thread_aggregate its own agg
+struct histogram_thread_data{
+    struct thread_data td;
+    int a;
+    int b;
+    int *hist;
+};
+
+struct aggregate_thread_data{
+    struct thread_data td;
+    int lo;
+    int hi;
+    struct aggregate agg;
+};
+
+// The args of the two passes of thread_find_pattern, thread_find_in_set and
+// thread_table_find
+struct pattern_args{
+    int *U;
+    int *pattern;
+    int m;
+};
+
+struct in_set_args{
+    int *U;
+    int i_step;
+    const struct value_set *set;
+};
+
+struct table_args{
+    struct table *tab;
+    struct predicate *preds;
+    int n_preds;
+};
+
 void* find_threadable(void* args){
     // Arguments passing
     int *U;
@@ -79,6 +194,8 @@ void* find_threadable(void* args){
 
     c = malloc(sizeof(int));
 
+    TRACE_BEGIN(t_scan);
+
     if(gc == NULL)
         *c = find(U, i_start, i_end, i_step, val, ind_val);
     else {
@@ -92,18 +209,22 @@ void* find_threadable(void* args){
         }
     }
 
+    TRACE_END(t_scan, "scan");
+
     pthread_exit((void*) c);
 }
 
 void* vect_find_threadable(void* args){
     int *U;
-    int i_start, i_end, i_step, val, i;
+    int i_start, i_end, i_step, val, base;
     int **ind_val;
     struct thread_data* targs;
     int *c;
+    unsigned int mask, lanes;
+    struct vect_scan sc;
 
     __m256i cmp_vect __attribute__((aligned (32))),
-            cmp_res  __attribute__((aligned (32)));
+            v        __attribute__((aligned (32)));
 
     targs = (struct thread_data*) args;
     U = targs->U;
@@ -115,6 +236,8 @@ void* vect_find_threadable(void* args){
 
     c = malloc(sizeof(int));
 
+    TRACE_BEGIN(t_scan);
+
     if(gc == NULL)
         *c = vect_find(U, i_start, i_end, i_step, val, ind_val);
     else {
@@ -123,33 +246,417 @@ void* vect_find_threadable(void* args){
 
         (*ind_val) = NULL;
 
-        for(i = i_start; i < i_end - 6; i += i_step * 8){
-            cmp_res = _mm256_cmpeq_epi32(cmp_vect, *((__m256i*)(U + i)));
+        vect_scan_init(&sc, U, i_start, i_end, i_step);
+        while(vect_scan_next(&sc, &base, &v, &lanes)){
+            mask = vect_eq_mask(v, cmp_vect) & lanes;
 
-            if(!_mm256_movemask_epi8(cmp_res))
-                continue;
+            while(mask){
+                test_U_j_with_gc(base + i_step * __builtin_ctz(mask));
+                mask &= mask - 1;
+            }
+        }
+    }
 
-            test_U_j_with_gc(i);
-            test_U_j_with_gc(i + 1);
-            test_U_j_with_gc(i + 2);
-            test_U_j_with_gc(i + 3);
-            test_U_j_with_gc(i + 4);
-            test_U_j_with_gc(i + 5);
-            test_U_j_with_gc(i + 6);
-            test_U_j_with_gc(i + 7);
+    TRACE_END(t_scan, "scan");
+
+    pthread_exit((void*) c);
+}
+
+/**
+ * The first pass of THREAD_FIND_AUTO: counts the matches of every sub-chunk
+ * of [i_start, i_end) into sub_counts and returns their sum.
+ */
+static int count_sub_chunks(struct find_two_pass_args *fa, int *sub_counts,
+                            int i_start, int i_end){
+    int j, start, c = 0;
+    int span = THREAD_FIND_AUTO_CHUNK * fa->i_step;
+
+    for(j = 0, start = i_start; start < i_end; j++, start += span){
+        sub_counts[j] = vect_count(fa->U, start, min(start + span, i_end),
+                                   fa->i_step, fa->val);
+        c += sub_counts[j];
+    }
+
+    return c;
+}
+
+/**
+ * The second pass of THREAD_FIND_AUTO: writes the positions of (at most
+ * max_c) matches of [i_start, i_end) into ind_val, sub-chunk by sub-chunk,
+ * with the kernel their density calls for.
+ */
+static void fill_sub_chunks(struct find_two_pass_args *fa, int *sub_counts,
+                            int i_start, int i_end, int *ind_val, int max_c){
+    int j, start, end, len, c = 0;
+    int span = THREAD_FIND_AUTO_CHUNK * fa->i_step;
+
+    for(j = 0, start = i_start; start < i_end && c < max_c;
+        j++, start += span){
+        // We already know there's nothing in there
+        if(sub_counts[j] == 0)
+            continue;
+
+        end = min(start + span, i_end);
+
+        // The last sub-chunk may well be shorter than the other ones
+        len = (end - start + fa->i_step - 1) / fa->i_step;
+
+        if(choose_find_strategy(len, (float) sub_counts[j] / len)
+                == FIND_STRATEGY_COMPRESS)
+            c += vect_find_compress_fill(fa->U, start, end, fa->i_step,
+                                         fa->val, ind_val + c,
+                                         min(sub_counts[j], max_c - c));
+        else
+            c += vect_find_fill(fa->U, start, end, fa->i_step, fa->val,
+                                ind_val + c, min(sub_counts[j], max_c - c));
+    }
+}
+
+static int find_count_chunk(void *arg, int id, int i_start, int i_end){
+    struct find_two_pass_args *fa = arg;
+
+    if(fa->ver != THREAD_FIND_AUTO)
+        return vect_count(fa->U, i_start, i_end, fa->i_step, fa->val);
+
+    fa->sub_counts[id] = malloc(sizeof(int) *
+                                ((i_end - i_start) /
+                                 (THREAD_FIND_AUTO_CHUNK * fa->i_step) + 1));
+    return count_sub_chunks(fa, fa->sub_counts[id], i_start, i_end);
+}
+
+static void find_fill_chunk(void *arg, int id, int i_start, int i_end,
+                            int *ind_val, int max_c){
+    struct find_two_pass_args *fa = arg;
+
+    if(fa->ver == THREAD_FIND_AUTO)
+        fill_sub_chunks(fa, fa->sub_counts[id], i_start, i_end, ind_val,
+                        max_c);
+    else
+        vect_find_fill(fa->U, i_start, i_end, fa->i_step, fa->val, ind_val,
+                       max_c);
+}
+
+void* two_pass_threadable(void* args){
+    int i, rem, serial;
+    struct two_pass_thread_data *targs;
+    struct two_pass_data *shared;
+
+    targs = (struct two_pass_thread_data*) args;
+    shared = targs->shared;
+
+    // First pass: just count what's in our chunk
+    TRACE_BEGIN(t_count);
+    shared->counts[targs->id] = shared->count(shared->arg, targs->id,
+                                              targs->i_start, targs->i_end);
+    TRACE_END(t_count, "count");
+
+    // Once everybody is done counting, one of us (whoever pthread gives the
+    // PTHREAD_BARRIER_SERIAL_THREAD return value to) turns the counts into
+    // offsets with an exclusive prefix sum and allocates the final array.
+    // Since the counts are exact, the k-factor simply truncates that sum and
+    // we get exactly the k first occurences.
+    TRACE_BEGIN(t_barrier);
+    serial = pthread_barrier_wait(&shared->barrier);
+    TRACE_END(t_barrier, "barrier wait");
+
+    if(serial == PTHREAD_BARRIER_SERIAL_THREAD){
+        shared->total = 0;
+        for(i = 0; i < shared->n_threads; i++){
+            shared->offsets[i] = shared->total;
+            shared->total += shared->counts[i];
         }
+        if(shared->k > 0)
+            shared->total = min(shared->total, shared->k);
 
-        for( ; i < i_end; i++){
-            test_U_j_with_gc(i);
+        (*shared->ind_val) = malloc(sizeof(int) * max(shared->total, 1));
+    }
+
+    TRACE_BEGIN(t_alloc);
+    pthread_barrier_wait(&shared->barrier);
+    TRACE_END(t_alloc, "barrier wait");
+
+    // Second pass: write our positions straight into our own slice of the
+    // final array, no realloc and no merge needed afterwards
+    rem = min(shared->total - shared->offsets[targs->id],
+              shared->counts[targs->id]);
+    TRACE_BEGIN(t_fill);
+    if(rem > 0)
+        shared->fill(shared->arg, targs->id, targs->i_start, targs->i_end,
+                     *shared->ind_val + shared->offsets[targs->id], rem);
+    TRACE_END(t_fill, "fill");
+
+    pthread_exit(NULL);
+}
+
+void* find_batch_threadable(void* args){
+    int q, t, bs, be, qs, qe, total, serial;
+    int *counts, *offsets, *written;
+    struct batch_thread_data *targs;
+    struct batch_data *shared;
+    struct find_query *query;
+
+    targs = (struct batch_thread_data*) args;
+    shared = targs->shared;
+    counts = shared->counts + targs->id * shared->n_queries;
+    offsets = shared->offsets + targs->id * shared->n_queries;
+
+    // First pass: every query counts its matches, block after block
+    TRACE_BEGIN(t_count);
+    for(q = 0; q < shared->n_queries; q++)
+        counts[q] = 0;
+
+    for(bs = targs->i_start; bs < targs->i_end; bs += THREAD_FIND_BATCH_BLOCK){
+        be = min(bs + THREAD_FIND_BATCH_BLOCK, targs->i_end);
+
+        for(q = 0; q < shared->n_queries; q++){
+            query = &shared->queries[q];
+            qs = max(bs, query->i_start);
+            qe = min(be, query->i_end);
+            if(qs < qe)
+                counts[q] += vect_count_range(targs->U, qs, qe, 1, query->lo,
+                                              query->hi);
+        }
+    }
+    TRACE_END(t_count, "count");
+
+    // One prefix sum per query, and the allocation of the results
+    TRACE_BEGIN(t_barrier);
+    serial = pthread_barrier_wait(&shared->barrier);
+    TRACE_END(t_barrier, "barrier wait");
+
+    if(serial == PTHREAD_BARRIER_SERIAL_THREAD){
+        for(q = 0; q < shared->n_queries; q++){
+            query = &shared->queries[q];
+            total = 0;
+            for(t = 0; t < shared->n_threads; t++){
+                shared->offsets[t * shared->n_queries + q] = total;
+                total += shared->counts[t * shared->n_queries + q];
+            }
+            query->count = total;
+            query->ind_val = query->want_positions ?
+                                malloc(sizeof(int) * total) : NULL;
         }
     }
 
-    pthread_exit((void*) c);
+    TRACE_BEGIN(t_alloc);
+    pthread_barrier_wait(&shared->barrier);
+    TRACE_END(t_alloc, "barrier wait");
+
+    // Second pass: the positions, for the queries that want them and still
+    // have some to find in our chunk
+    TRACE_BEGIN(t_fill);
+    written = calloc(shared->n_queries, sizeof(int));
+
+    for(bs = targs->i_start; bs < targs->i_end; bs += THREAD_FIND_BATCH_BLOCK){
+        be = min(bs + THREAD_FIND_BATCH_BLOCK, targs->i_end);
+
+        for(q = 0; q < shared->n_queries; q++){
+            query = &shared->queries[q];
+            if(!query->want_positions || written[q] == counts[q])
+                continue;
+
+            qs = max(bs, query->i_start);
+            qe = min(be, query->i_end);
+            if(qs < qe)
+                written[q] += vect_find_range_fill(targs->U, qs, qe, 1,
+                                    query->lo, query->hi,
+                                    query->ind_val + offsets[q] + written[q],
+                                    counts[q] - written[q]);
+        }
+    }
+
+    free(written);
+    TRACE_END(t_fill, "fill");
+
+    pthread_exit(NULL);
+}
+
+// Every thread looks for the occurences starting in its chunk, the last one
+// of them ending m - 1 elements further, in the next chunk (which it only
+// reads)
+static int pattern_count_chunk(void *arg, int id, int i_start, int i_end){
+    struct pattern_args *pa = arg;
+    (void) id;
+
+    return vect_count_pattern(pa->U, i_start, i_end + pa->m - 1, pa->pattern,
+                              pa->m);
+}
+
+static void pattern_fill_chunk(void *arg, int id, int i_start, int i_end,
+                               int *ind_val, int max_c){
+    struct pattern_args *pa = arg;
+    (void) id;
+
+    vect_find_pattern_fill(pa->U, i_start, i_end + pa->m - 1, pa->pattern,
+                           pa->m, ind_val, max_c);
+}
+
+static int in_set_count_chunk(void *arg, int id, int i_start, int i_end){
+    struct in_set_args *sa = arg;
+    (void) id;
+
+    return vect_count_in_set(sa->U, i_start, i_end, sa->i_step, sa->set);
+}
+
+static void in_set_fill_chunk(void *arg, int id, int i_start, int i_end,
+                              int *ind_val, int max_c){
+    struct in_set_args *sa = arg;
+    (void) id;
+
+    vect_find_in_set_fill(sa->U, i_start, i_end, sa->i_step, sa->set, ind_val,
+                          max_c);
+}
+
+static int table_count_chunk(void *arg, int id, int i_start, int i_end){
+    struct table_args *ta = arg;
+    (void) id;
+
+    return vect_table_count(ta->tab, i_start, i_end, ta->preds, ta->n_preds);
+}
+
+static void table_fill_chunk(void *arg, int id, int i_start, int i_end,
+                             int *ind_val, int max_c){
+    struct table_args *ta = arg;
+    (void) id;
+
+    vect_table_find_fill(ta->tab, i_start, i_end, ta->preds, ta->n_preds,
+                         ind_val, max_c);
+}
+
+void* histogram_threadable(void* args){
+    struct histogram_thread_data *targs;
+
+    targs = (struct histogram_thread_data*) args;
+
+    TRACE_BEGIN(t_scan);
+    vect_histogram(targs->td.U, targs->td.i_start, targs->td.i_end,
+                   targs->td.i_step, targs->a, targs->b, targs->hist);
+    TRACE_END(t_scan, "scan");
+
+    pthread_exit(NULL);
+}
+
+void* aggregate_threadable(void* args){
+    struct aggregate_thread_data *targs;
+
+    targs = (struct aggregate_thread_data*) args;
+
+    TRACE_BEGIN(t_scan);
+    vect_aggregate(targs->td.U, targs->td.i_start, targs->td.i_end,
+                   targs->td.i_step, targs->lo, targs->hi, &targs->agg);
+    TRACE_END(t_scan, "scan");
+
+    pthread_exit(NULL);
+}
+
+void set_number_of_threads(int n_threads){
+    forced_n_threads = max(n_threads, 0);
+}
+
+static int get_number_of_threads(){
+    return forced_n_threads > 0 ? forced_n_threads : get_number_of_cores();
+}
+
+/**
+ * Computes the boundaries of the i-th out of n_threads chunks of
+ * [i_start, i_end).
+ */
+static void get_chunk(int i_start, int i_end, int i_step, int n_threads,
+                      int i, int *chunk_start, int *chunk_end){
+    int chunk_size;
+
+    // Every chunk must start on an index reachable from i_start by steps of
+    // i_step. The vectorial kernels deal with any alignment but rounding to
+    // 8 * i_step also keeps every chunk as aligned as U + i_start is, so that
+    // only the first one can have a partial first block.
+    chunk_size = (i_end - i_start)/n_threads;
+    chunk_size -= (chunk_size % (8 * i_step));
+    *chunk_start = i_start + chunk_size * i;
+    if(i < n_threads - 1)
+        *chunk_end = i_start + chunk_size * (i + 1);
+    else
+        *chunk_end = i_end;
+}
+
+/**
+ * Runs a two-pass search over [i_start, i_end) on n_threads threads, count
+ * and fill (given arg) being called on the chunks get_chunk gives them. The
+ * positions of the matches (the k first ones if k > 0) end up in *ind_val,
+ * their number is returned.
+ */
+static int thread_two_pass(int n_threads, int i_start, int i_end, int i_step,
+                           int k, two_pass_count_fn count,
+                           two_pass_fill_fn fill, void *arg, int **ind_val){
+    int i;
+    pthread_t *thread;
+    struct two_pass_thread_data *attr;
+    struct two_pass_data shared;
+
+    thread = malloc(n_threads * sizeof(pthread_t));
+    attr = malloc(n_threads * sizeof(struct two_pass_thread_data));
+
+    shared.n_threads = n_threads;
+    shared.k = k;
+    shared.count = count;
+    shared.fill = fill;
+    shared.arg = arg;
+    shared.counts = malloc(n_threads * sizeof(int));
+    shared.offsets = malloc(n_threads * sizeof(int));
+    shared.ind_val = ind_val;
+    pthread_barrier_init(&shared.barrier, NULL, n_threads);
+
+    for(i = 0; i < n_threads; i++){
+        get_chunk(i_start, i_end, i_step, n_threads, i, &attr[i].i_start,
+                  &attr[i].i_end);
+        attr[i].id = i;
+        attr[i].shared = &shared;
+
+        TRACE_BEGIN(t_spawn);
+        pthread_create(&thread[i], NULL, two_pass_threadable,
+                       (void *) &attr[i]);
+        TRACE_END(t_spawn, "spawn");
+    }
+
+    TRACE_BEGIN(t_join);
+    for(i = 0; i < n_threads; i++)
+        pthread_join(thread[i], NULL);
+    TRACE_END(t_join, "join");
+
+    pthread_barrier_destroy(&shared.barrier);
+    free(shared.counts);
+    free(shared.offsets);
+    free(attr);
+    free(thread);
+
+    return shared.total;
+}
+
+static int thread_find_two_pass(int *U, int i_start, int i_end, int i_step,
+                                int val, int **ind_val, int k, int ver){
+    int n_threads, i, c;
+    struct find_two_pass_args fa;
+
+    n_threads = get_number_of_threads();
+
+    fa.U = U;
+    fa.i_step = i_step;
+    fa.val = val;
+    fa.ver = ver;
+    fa.sub_counts = calloc(n_threads, sizeof(int*));
+
+    c = thread_two_pass(n_threads, i_start, i_end, i_step, k,
+                        &find_count_chunk, &find_fill_chunk, &fa, ind_val);
+
+    for(i = 0; i < n_threads; i++)
+        free(fa.sub_counts[i]);
+    free(fa.sub_counts);
+
+    return c;
 }
 
 int thread_find(int *U, int i_start, int i_end, int i_step, int val,
                 int **ind_val, int k, int ver){
-    int n_threads, i, c, l, chunk_size;
+    int n_threads, i, c, l;
     int *partial_count;
     int *s; // The number of matches returned by each thread
     int ***ind_vals;
@@ -164,9 +671,21 @@ int thread_find(int *U, int i_start, int i_end, int i_step, int val,
     // number of occurences to find has been reached. (Also it's with the value
     // that we managed to reach the highest performance with the best
     // reproductability).
-    n_threads = get_number_of_cores();
+    n_threads = get_number_of_threads();
+
+    // No global estimate of the selectivity here: an array that is sparse
+    // overall may still have dense regions, and every sub-chunk gets the
+    // kernel its own count calls for anyway
+    if(ver == THREAD_FIND_AUTO && k <= 0 &&
+       (i_end - i_start) / i_step < THREAD_FIND_AUTO_MIN_N)
+        return find_auto(U, i_start, i_end, i_step, val, ind_val);
 
-    if(ver == 0)
+    // The two-pass versions have their own way of gathering results
+    if(ver == THREAD_FIND_TWO_PASS || ver == THREAD_FIND_AUTO)
+        return thread_find_two_pass(U, i_start, i_end, i_step, val, ind_val,
+                                    k, ver);
+
+    if(ver == THREAD_FIND_SCALAR)
         find_routine = &find_threadable;
     else
         find_routine = &vect_find_threadable;
@@ -191,16 +710,8 @@ int thread_find(int *U, int i_start, int i_end, int i_step, int val,
 
     for(i = 0; i < n_threads; i++){
         attr[i].U = U;
-        // We have to round that up to make sure our subarrays are
-        // aligned too (that's why we get a segfault when the number of threads
-        // we launch is odd.
-        chunk_size = (i_end - i_start)/n_threads;
-        chunk_size -= (chunk_size % 8);
-        attr[i].i_start = i_start + chunk_size * i;
-        if(i < n_threads - 1)
-            attr[i].i_end = i_start + chunk_size * (i + 1);
-        else
-            attr[i].i_end = i_end;
+        get_chunk(i_start, i_end, i_step, n_threads, i, &attr[i].i_start,
+                  &attr[i].i_end);
         attr[i].i_step = i_step;
         attr[i].val = val;
         ind_vals[i] = malloc(sizeof(int*));
@@ -208,19 +719,24 @@ int thread_find(int *U, int i_start, int i_end, int i_step, int val,
         attr[i].ind_val = ind_vals[i];
 
         // Let's launch our individual threads
+        TRACE_BEGIN(t_spawn);
         pthread_create(&thread[i], NULL, find_routine,
                        (void *)((struct thread_data*) &attr[i]));
+        TRACE_END(t_spawn, "spawn");
     }
 
     // Let's just wait for our threads to finish no matter the reason
     // And let's also initialize pointers for the single array creation
+    TRACE_BEGIN(t_join);
     for(i = 0; i < n_threads; i++){
         pthread_join(thread[i], (void **) &partial_count);
         s[i] = *partial_count;
     }
     free(partial_count);
+    TRACE_END(t_join, "join");
 
     // Let's prepare the final data structures
+    TRACE_BEGIN(t_merge);
     c = 0;
     for(i = 0; i < n_threads; i++){
         c += s[i];
@@ -237,6 +753,7 @@ int thread_find(int *U, int i_start, int i_end, int i_step, int val,
         l += min(s[i], c - l);
         free(*ind_vals[i]);
     }
+    TRACE_END(t_merge, "merge");
 
     // Let's free our last resources
     if(gc != NULL){
@@ -248,3 +765,180 @@ int thread_find(int *U, int i_start, int i_end, int i_step, int val,
     return c;
 }
 
+
+void thread_find_batch(int *U, int i_start, int i_end,
+                       struct find_query *queries, int n_queries){
+    int n_threads, i;
+    pthread_t *thread;
+    struct batch_thread_data *attr;
+    struct batch_data shared;
+
+    n_threads = get_number_of_threads();
+
+    thread = malloc(n_threads * sizeof(pthread_t));
+    attr = malloc(n_threads * sizeof(struct batch_thread_data));
+
+    shared.n_threads = n_threads;
+    shared.queries = queries;
+    shared.n_queries = n_queries;
+    shared.counts = malloc(n_threads * n_queries * sizeof(int));
+    shared.offsets = malloc(n_threads * n_queries * sizeof(int));
+    pthread_barrier_init(&shared.barrier, NULL, n_threads);
+
+    for(i = 0; i < n_threads; i++){
+        attr[i].U = U;
+        get_chunk(i_start, i_end, 1, n_threads, i, &attr[i].i_start,
+                  &attr[i].i_end);
+        attr[i].id = i;
+        attr[i].shared = &shared;
+
+        TRACE_BEGIN(t_spawn);
+        pthread_create(&thread[i], NULL, find_batch_threadable,
+                       (void *) &attr[i]);
+        TRACE_END(t_spawn, "spawn");
+    }
+
+    TRACE_BEGIN(t_join);
+    for(i = 0; i < n_threads; i++)
+        pthread_join(thread[i], NULL);
+    TRACE_END(t_join, "join");
+
+    pthread_barrier_destroy(&shared.barrier);
+    free(shared.counts);
+    free(shared.offsets);
+    free(attr);
+    free(thread);
+}
+
+void thread_histogram(int *U, int i_start, int i_end, int i_step, int a, int b,
+                      int *hist){
+    int n_threads, i, width;
+    int *hists;
+    pthread_t *thread;
+    struct histogram_thread_data *attr;
+
+    n_threads = get_number_of_threads();
+    width = b - a + 1;
+
+    thread = malloc(n_threads * sizeof(pthread_t));
+    attr = malloc(n_threads * sizeof(struct histogram_thread_data));
+    hists = malloc(n_threads * width * sizeof(int));
+
+    for(i = 0; i < n_threads; i++){
+        attr[i].td.U = U;
+        get_chunk(i_start, i_end, i_step, n_threads, i, &attr[i].td.i_start,
+                  &attr[i].td.i_end);
+        attr[i].td.i_step = i_step;
+        attr[i].a = a;
+        attr[i].b = b;
+        attr[i].hist = hists + i * width;
+
+        TRACE_BEGIN(t_spawn);
+        pthread_create(&thread[i], NULL, histogram_threadable,
+                       (void *) &attr[i]);
+        TRACE_END(t_spawn, "spawn");
+    }
+
+    TRACE_BEGIN(t_join);
+    for(i = 0; i < n_threads; i++)
+        pthread_join(thread[i], NULL);
+    TRACE_END(t_join, "join");
+
+    // The same vectorial sum as the one of the copies of each thread
+    TRACE_BEGIN(t_merge);
+    memcpy(hist, hists, width * sizeof(int));
+    for(i = 1; i < n_threads; i++)
+        vect_add_ints(hist, hists + i * width, width);
+    TRACE_END(t_merge, "merge");
+
+    free(hists);
+    free(attr);
+    free(thread);
+}
+
+void thread_aggregate(int *U, int i_start, int i_end, int i_step, int lo,
+                      int hi, struct aggregate *agg){
+    int n_threads, i;
+    pthread_t *thread;
+    struct aggregate_thread_data *attr;
+
+    n_threads = get_number_of_threads();
+
+    thread = malloc(n_threads * sizeof(pthread_t));
+    attr = malloc(n_threads * sizeof(struct aggregate_thread_data));
+
+    for(i = 0; i < n_threads; i++){
+        attr[i].td.U = U;
+        get_chunk(i_start, i_end, i_step, n_threads, i, &attr[i].td.i_start,
+                  &attr[i].td.i_end);
+        attr[i].td.i_step = i_step;
+        attr[i].lo = lo;
+        attr[i].hi = hi;
+
+        TRACE_BEGIN(t_spawn);
+        pthread_create(&thread[i], NULL, aggregate_threadable,
+                       (void *) &attr[i]);
+        TRACE_END(t_spawn, "spawn");
+    }
+
+    TRACE_BEGIN(t_join);
+    for(i = 0; i < n_threads; i++)
+        pthread_join(thread[i], NULL);
+    TRACE_END(t_join, "join");
+
+    (*agg) = attr[0].agg;
+    for(i = 1; i < n_threads; i++)
+        merge_aggregates(agg, &attr[i].agg);
+
+    free(attr);
+    free(thread);
+}
+
+int thread_find_pattern(int *U, int i_start, int i_end, int *pattern, int m,
+                        int **ind_val){
+    struct pattern_args pa;
+
+    if(i_end - i_start < THREAD_FIND_AUTO_MIN_N)
+        return vect_find_pattern(U, i_start, i_end, pattern, m, ind_val);
+
+    pa.U = U;
+    pa.pattern = pattern;
+    pa.m = m;
+
+    // The chunks of the positions where an occurence can start
+    return thread_two_pass(get_number_of_threads(), i_start, i_end - m + 1, 1,
+                           0, &pattern_count_chunk, &pattern_fill_chunk, &pa,
+                           ind_val);
+}
+
+int thread_find_in_set(int *U, int i_start, int i_end, int i_step,
+                       const struct value_set *set, int **ind_val){
+    struct in_set_args sa;
+
+    if(i_end - i_start < THREAD_FIND_AUTO_MIN_N)
+        return vect_find_in_set(U, i_start, i_end, i_step, set, ind_val);
+
+    sa.U = U;
+    sa.i_step = i_step;
+    sa.set = set;
+
+    return thread_two_pass(get_number_of_threads(), i_start, i_end, i_step, 0,
+                           &in_set_count_chunk, &in_set_fill_chunk, &sa,
+                           ind_val);
+}
+
+int thread_table_find(struct table *tab, struct predicate *preds, int n_preds,
+                      int **ind_val){
+    struct table_args ta;
+
+    if(tab->n < THREAD_FIND_AUTO_MIN_N)
+        return vect_table_find(tab, 0, tab->n, preds, n_preds, ind_val);
+
+    ta.tab = tab;
+    ta.preds = preds;
+    ta.n_preds = n_preds;
+
+    return thread_two_pass(get_number_of_threads(), 0, tab->n, 1, 0,
+                           &table_count_chunk, &table_fill_chunk, &ta,
+                           ind_val);
+}
@@ -21,7 +21,108 @@
 #ifndef _THREAD_FIND_H_
 #define _THREAD_FIND_H_
 
+#include "find.h"
+#include "table.h"
+#include "value_set.h"
+
+// The available implementations of thread_find (its ver argument):
+//  - THREAD_FIND_SCALAR: every thread runs find on its chunk
+//  - THREAD_FIND_VECT: every thread runs vect_find on its chunk
+//  - THREAD_FIND_TWO_PASS: every thread counts the matches in its chunk with
+//    vect_count, then an exclusive prefix sum of these counts tells each thread
+//    where to write its positions in the (pre-sized) final array
+//  - THREAD_FIND_AUTO: THREAD_FIND_TWO_PASS, except that every thread counts
+//    the matches of each sub-chunk of THREAD_FIND_AUTO_CHUNK elements of its
+//    chunk, then skips the empty ones and fills the other ones with the kernel
+//    that suits their own density (see find_auto.h), so that the dense
+//    regions of an otherwise sparse array get the compress kernel too.
+//    Small searches aren't worth spawning threads and are handed to find_auto.
+#define THREAD_FIND_SCALAR      0
+#define THREAD_FIND_VECT        1
+#define THREAD_FIND_TWO_PASS    2
+#define THREAD_FIND_AUTO        3
+
+#define THREAD_FIND_AUTO_CHUNK  65536
+#define THREAD_FIND_AUTO_MIN_N  32768
+
 int thread_find(int *U, int i_start, int i_end, int i_step, int val,
                 int **ind_val, int k, int ver);
 
+/**
+ * A query of a batch: the elements of U between the indexes i_start and i_end
+ * such that lo <= U[i] <= hi (lo = hi = val for a plain find). Their number
+ * always ends up in count, their positions only if want_positions is set, in
+ * ind_val (to be freed by the caller).
+ */
+struct find_query{
+    int i_start;
+    int i_end;
+    int lo;
+    int hi;
+    int want_positions;
+    int count;
+    int *ind_val;
+};
+
+// The batches are run block by block: every query of the batch looks at a
+// block while it's still in the L2 cache, so that U is only streamed once
+// from memory per batch instead of once per query.
+#define THREAD_FIND_BATCH_BLOCK 16384
+
+/**
+ * Answers n_queries queries in shared passes over [i_start, i_end), split
+ * between threads like thread_find does. The same two passes as
+ * THREAD_FIND_TWO_PASS happen: every thread counts the matches of each query
+ * in its chunk, then a prefix sum per query gives every thread where to write
+ * its positions.
+ */
+void thread_find_batch(int *U, int i_start, int i_end,
+                       struct find_query *queries, int n_queries);
+
+/**
+ * The multithreaded counterparts of vect_histogram and vect_aggregate (see
+ * find.h): every thread works on its own chunk of [i_start, i_end), with its
+ * own copies of the histogram (resp. its own aggregate), and the results of
+ * the threads are merged once they're all done.
+ */
+void thread_histogram(int *U, int i_start, int i_end, int i_step, int a, int b,
+                      int *hist);
+
+void thread_aggregate(int *U, int i_start, int i_end, int i_step, int lo,
+                      int hi, struct aggregate *agg);
+
+/**
+ * The multithreaded counterpart of vect_find_pattern (see find.h), with the
+ * two passes of THREAD_FIND_TWO_PASS. The chunks split the positions where an
+ * occurence may start, not the elements: every thread reads up to m - 1
+ * elements past the end of its chunk, so that an occurence straddling two
+ * chunks is found (once) by the thread of the chunk where it starts. Small
+ * searches (below THREAD_FIND_AUTO_MIN_N elements) don't spawn any thread.
+ */
+int thread_find_pattern(int *U, int i_start, int i_end, int *pattern, int m,
+                        int **ind_val);
+
+/**
+ * The multithreaded counterpart of vect_find_in_set (see value_set.h), with
+ * the two passes of THREAD_FIND_TWO_PASS. All the threads probe the same set,
+ * which they only read. Small searches (below THREAD_FIND_AUTO_MIN_N
+ * elements) don't spawn any thread.
+ */
+int thread_find_in_set(int *U, int i_start, int i_end, int i_step,
+                       const struct value_set *set, int **ind_val);
+
+/**
+ * The multithreaded counterpart of vect_table_find (see table.h) over all the
+ * rows of tab, with the two passes of THREAD_FIND_TWO_PASS. Small tables
+ * (below THREAD_FIND_AUTO_MIN_N rows) don't spawn any thread.
+ */
+int thread_table_find(struct table *tab, struct predicate *preds, int n_preds,
+                      int **ind_val);
+
+/**
+ * Sets the number of threads thread_find launches. By default (or when
+ * n_threads <= 0) it launches one thread per online core.
+ */
+void set_number_of_threads(int n_threads);
+
 #endif
@@ -0,0 +1,172 @@
+/*
+ * ============================================================================
+ *
+ *       Filename:  trace.c
+ *
+ *    Description:  Implementation of our timeline tracer: the per-thread ring
+ *                  buffers and their export as Chrome trace JSON.
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 06:15:26
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  agent (agent@local)
+ *
+ * ============================================================================
+ */
+
+#define _XOPEN_SOURCE 600
+
+#include "trace.h"
+
+#ifdef TRACE
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+struct trace_span{
+    const char *name;
+    long start;
+    long end;
+};
+
+// The spans of a thread. thread_find creates new threads every time it's
+// called, so a buffer gets back to the pool when its thread exits and the
+// next new thread reuses it: every buffer is a "lane" of the timeline, the
+// threads of successive calls following each other on the same lanes.
+struct trace_buffer{
+    int lane;
+    int in_use;
+    // The number of spans ever recorded, the last TRACE_RING_SIZE of them are
+    // in spans
+    long n;
+    struct trace_span spans[TRACE_RING_SIZE];
+    struct trace_buffer *next;
+};
+
+// Every buffer ever allocated, only touched when a thread records its first
+// span or exits, never on the hot path
+static struct trace_buffer *buffers = NULL;
+static int n_lanes = 0;
+static pthread_mutex_t buffers_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_key_t buffer_key;
+static pthread_once_t buffer_key_once = PTHREAD_ONCE_INIT;
+
+// The buffer of the calling thread
+static __thread struct trace_buffer *buffer = NULL;
+
+static void release_buffer(void *b){
+    pthread_mutex_lock(&buffers_lock);
+    ((struct trace_buffer*) b)->in_use = 0;
+    pthread_mutex_unlock(&buffers_lock);
+}
+
+static void create_buffer_key(){
+    pthread_key_create(&buffer_key, &release_buffer);
+}
+
+/**
+ * Gives the calling thread a buffer, a free one if there's any.
+ */
+static struct trace_buffer* acquire_buffer(){
+    struct trace_buffer *b;
+
+    pthread_once(&buffer_key_once, &create_buffer_key);
+
+    pthread_mutex_lock(&buffers_lock);
+
+    for(b = buffers; b != NULL && b->in_use; b = b->next);
+
+    if(b == NULL){
+        b = malloc(sizeof(struct trace_buffer));
+        b->lane = n_lanes++;
+        b->n = 0;
+        b->next = buffers;
+        buffers = b;
+    }
+    b->in_use = 1;
+
+    pthread_mutex_unlock(&buffers_lock);
+
+    // So that release_buffer gets called when the thread exits
+    pthread_setspecific(buffer_key, b);
+
+    return b;
+}
+
+long trace_now(){
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return t.tv_sec * 1000000000L + t.tv_nsec;
+}
+
+void trace_record(const char *name, long start, long end){
+    struct trace_span *span;
+
+    if(buffer == NULL)
+        buffer = acquire_buffer();
+
+    span = &buffer->spans[buffer->n % TRACE_RING_SIZE];
+    span->name = name;
+    span->start = start;
+    span->end = end;
+    buffer->n++;
+}
+
+int trace_export(const char *path){
+    long k, first, origin;
+    int sep;
+    FILE *out;
+    struct trace_buffer *b;
+    struct trace_span *span;
+
+    out = fopen(path, "w");
+    if(out == NULL)
+        return -1;
+
+    pthread_mutex_lock(&buffers_lock);
+
+    // The timestamps are given from the first span we still have, in µs
+    origin = -1;
+    for(b = buffers; b != NULL; b = b->next){
+        for(k = (b->n > TRACE_RING_SIZE) ? b->n - TRACE_RING_SIZE : 0;
+            k < b->n; k++){
+            span = &b->spans[k % TRACE_RING_SIZE];
+            if(origin < 0 || span->start < origin)
+                origin = span->start;
+        }
+    }
+
+    fprintf(out, "{\"traceEvents\": [\n");
+    sep = 0;
+
+    for(b = buffers; b != NULL; b = b->next){
+        fprintf(out, "%s  {\"name\": \"thread_name\", \"ph\": \"M\", "
+                "\"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"lane %d\"}}",
+                sep ? ",\n" : "", b->lane, b->lane);
+        sep = 1;
+
+        first = (b->n > TRACE_RING_SIZE) ? b->n - TRACE_RING_SIZE : 0;
+        for(k = first; k < b->n; k++){
+            span = &b->spans[k % TRACE_RING_SIZE];
+            fprintf(out, ",\n  {\"name\": \"%s\", \"ph\": \"X\", "
+                    "\"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                    span->name, b->lane, (span->start - origin) / 1e3,
+                    (span->end - span->start) / 1e3);
+        }
+    }
+
+    fprintf(out, "\n], \"displayTimeUnit\": \"ns\"}\n");
+
+    pthread_mutex_unlock(&buffers_lock);
+
+    return fclose(out);
+}
+
+#endif
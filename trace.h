@@ -0,0 +1,66 @@
+/*
+ * ============================================================================
+ *
+ *       Filename:  trace.h
+ *
+ *    Description:  A timeline tracer for our threads: timestamped spans
+ *                  (thread creation, scans, lock waits, reallocs, joins,
+ *                  merges...) recorded in per-thread ring buffers and exported
+ *                  in the Chrome trace event format, which chrome://tracing
+ *                  and ui.perfetto.dev can open.
+ *
+ *                  It only exists when compiled with -DTRACE (make TRACE=1),
+ *                  otherwise all the macros below expand to nothing at all.
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 06:15:26
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  agent (agent@local)
+ *
+ * ============================================================================
+ */
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+// The number of spans each thread keeps, the oldest ones get overwritten
+#define TRACE_RING_SIZE 16384
+
+#ifdef TRACE
+
+/**
+ * TRACE_BEGIN(span) declares span and stores the current time in it,
+ * TRACE_END(span, name) records the span name from then to now for the
+ * calling thread:
+ *
+ *   TRACE_BEGIN(t_join);
+ *   pthread_join(thread, NULL);
+ *   TRACE_END(t_join, "join");
+ *
+ * name must be a string literal (only its address is kept).
+ */
+#define TRACE_BEGIN(span)       long span = trace_now()
+#define TRACE_END(span, name)   trace_record(name, span, trace_now())
+
+/**
+ * Writes every span recorded so far to the file path, as Chrome trace JSON.
+ */
+#define TRACE_EXPORT(path)      trace_export(path)
+
+long trace_now();
+
+void trace_record(const char *name, long start, long end);
+
+int trace_export(const char *path);
+
+#else
+
+#define TRACE_BEGIN(span)
+#define TRACE_END(span, name)
+#define TRACE_EXPORT(path)
+
+#endif
+
+#endif
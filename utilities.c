@@ -21,6 +21,7 @@
  */
 #include "utilities.h"
 
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -29,8 +30,6 @@
  * A function generating an n-size array of random integers between a and b
  */
 int* generate_array(int n, int a, int b){
-    int i;
-
     // Let's create the array
     int *res;
 
@@ -39,13 +38,24 @@ int* generate_array(int n, int a, int b){
     // Let's seed the random number generator using the current time
     srand(time(NULL));
 
-    // And let's fill up the array in a vectorial way
-    for(i = 0; i < n; i++)
-        res[i] = rand() % (b - a + 1) + a;
+    fill_array(res, n, a, b);
 
     return res;
 }
 
+/**
+ * Fills an existing n-size array with random integers between a and b, going
+ * on with the current rand() stream (whoever wants reproducible data seeds it
+ * once beforehand)
+ */
+void fill_array(int *U, int n, int a, int b){
+    int i;
+
+    // Let's fill up the array in a vectorial way
+    for(i = 0; i < n; i++)
+        U[i] = rand() % (b - a + 1) + a;
+}
+
 void print_array(int* U, int n){
     int i;
     printf("[");
@@ -63,7 +73,46 @@ long tdiff_micros(struct timespec t0, struct timespec t1){
            (t1.tv_nsec - t0.tv_nsec)/1000;
 }
 
+long tdiff_nanos(struct timespec t0, struct timespec t1){
+    return (long)(t1.tv_sec - t0.tv_sec)*1000000000 +
+           (t1.tv_nsec - t0.tv_nsec);
+}
+
 int get_number_of_cores(){
     // Works only on Linux with GCC/glibc, relies on unistd.h
     return sysconf(_SC_NPROCESSORS_ONLN);
 }
+
+int read_full(int fd, void *buf, size_t len){
+    ssize_t r;
+    char *p = buf;
+
+    while(len > 0){
+        r = read(fd, p, len);
+        if(r < 0 && errno == EINTR)
+            continue;
+        if(r <= 0)
+            return -1;
+        p += r;
+        len -= r;
+    }
+
+    return 0;
+}
+
+int write_full(int fd, const void *buf, size_t len){
+    ssize_t r;
+    const char *p = buf;
+
+    while(len > 0){
+        r = write(fd, p, len);
+        if(r < 0 && errno == EINTR)
+            continue;
+        if(r <= 0)
+            return -1;
+        p += r;
+        len -= r;
+    }
+
+    return 0;
+}
@@ -24,6 +24,7 @@
 // Let's choose the POSIX definitions we want
 #define _XOPEN_SOURCE 600
 
+#include <stddef.h>
 #include <time.h>
 
 // Our finely crafted min macro
@@ -32,15 +33,38 @@
        __typeof__ (b) _b = (b); \
      _a < _b ? _a : _b; })
 
+// And its max counterpart
+#define max(a,b) \
+   ({ __typeof__ (a) _a = (a); \
+       __typeof__ (b) _b = (b); \
+     _a > _b ? _a : _b; })
+
 /**
  * A function generating an n-size array of random integers between a and b
  */
 int* generate_array(int n, int a, int b);
 
+/**
+ * Fills an existing n-size array with random integers between a and b, from
+ * the current rand() stream (it doesn't seed it)
+ */
+void fill_array(int *U, int n, int a, int b);
+
 void print_array(int* U, int n);
 
 long tdiff_micros(struct timespec t0, struct timespec t1);
 
+long tdiff_nanos(struct timespec t0, struct timespec t1);
+
 int get_number_of_cores();
 
+/**
+ * Reads (resp. writes) exactly len bytes from (resp. to) fd, going on after
+ * partial reads/writes and interruptions. Returns 0 on success, -1 if fd got
+ * closed or on error.
+ */
+int read_full(int fd, void *buf, size_t len);
+
+int write_full(int fd, const void *buf, size_t len);
+
 #endif
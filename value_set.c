@@ -0,0 +1,323 @@
+/*
+ * ============================================================================
+ *
+ *       Filename:  value_set.c
+ *
+ *    Description:  Implementation of our sets of values: their construction
+ *                  and the scalar and vectorial membership searches.
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 06:21:28
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  agent (agent@local)
+ *
+ * ============================================================================
+ */
+
+#include "value_set.h"
+
+#include <stdlib.h>
+
+#include "utilities.h"
+#include "vect_utils.h"
+
+// The first size of the result arrays of find_in_set and vect_find_in_set
+#define SET_FIND_INITIAL_SIZE 64
+
+// The smallest hash table we build
+#define SET_HASH_MIN_SLOTS 16
+
+VECT_INLINE unsigned int hash_slot(const struct value_set *set, int v){
+    return ((unsigned int) v * VALUE_SET_HASH_MULT) >> set->shift;
+}
+
+static void insert_key(struct value_set *set, int v){
+    unsigned int h;
+
+    if(v == VALUE_SET_EMPTY){
+        set->n += !set->empty_member;
+        set->empty_member = 1;
+        return;
+    }
+
+    for(h = hash_slot(set, v); set->keys[h] != VALUE_SET_EMPTY;
+        h = (h + 1) & set->mask){
+        // Already there
+        if(set->keys[h] == v)
+            return;
+    }
+
+    set->keys[h] = v;
+    set->n++;
+}
+
+struct value_set* value_set_create(int *values, int n_values, int kind){
+    int i, bits;
+    long long domain, slots;
+    struct value_set *set;
+
+    set = malloc(sizeof(struct value_set));
+    set->n = 0;
+    set->min = 0;
+    set->max = -1;
+    set->bits = NULL;
+    set->keys = NULL;
+    set->mask = 0;
+    set->shift = 0;
+    set->empty_member = 0;
+
+    for(i = 0; i < n_values; i++){
+        if(i == 0 || values[i] < set->min)
+            set->min = values[i];
+        if(i == 0 || values[i] > set->max)
+            set->max = values[i];
+    }
+
+    // A table at most half full: twice as many slots as values, rounded up to
+    // a power of two
+    for(bits = 4, slots = SET_HASH_MIN_SLOTS; slots < 2LL * n_values;
+        bits++, slots *= 2);
+
+    domain = (long long) set->max - set->min + 1;
+
+    // The bitmap wins ties: a single gather per block, whatever the values
+    if(kind == VALUE_SET_AUTO)
+        kind = (domain / 8 <= slots * (long long) sizeof(int)) ?
+                    VALUE_SET_BITMAP : VALUE_SET_HASH;
+    if(n_values == 0 || domain > VALUE_SET_BITMAP_MAX_BITS)
+        kind = VALUE_SET_HASH;
+
+    set->kind = kind;
+
+    if(kind == VALUE_SET_BITMAP){
+        set->bits = calloc(domain / 32 + 1, sizeof(unsigned int));
+        for(i = 0; i < n_values; i++){
+            // Let's count every value once
+            if(!(set->bits[(unsigned int)(values[i] - set->min) / 32] &
+                 (1u << ((unsigned int)(values[i] - set->min) % 32)))){
+                set->bits[(unsigned int)(values[i] - set->min) / 32] |=
+                    1u << ((unsigned int)(values[i] - set->min) % 32);
+                set->n++;
+            }
+        }
+    } else {
+        set->mask = (unsigned int)(slots - 1);
+        set->shift = 32 - bits;
+        set->keys = malloc(slots * sizeof(int));
+        for(i = 0; i < slots; i++)
+            set->keys[i] = VALUE_SET_EMPTY;
+        for(i = 0; i < n_values; i++)
+            insert_key(set, values[i]);
+    }
+
+    return set;
+}
+
+void value_set_free(struct value_set *set){
+    free(set->bits);
+    free(set->keys);
+    free(set);
+}
+
+int value_set_contains(const struct value_set *set, int v){
+    unsigned int h;
+
+    if(set->kind == VALUE_SET_BITMAP){
+        if(v < set->min || v > set->max)
+            return 0;
+        return (set->bits[(unsigned int)(v - set->min) / 32] >>
+                ((unsigned int)(v - set->min) % 32)) & 1;
+    }
+
+    if(v == VALUE_SET_EMPTY)
+        return set->empty_member;
+
+    for(h = hash_slot(set, v); set->keys[h] != VALUE_SET_EMPTY;
+        h = (h + 1) & set->mask){
+        if(set->keys[h] == v)
+            return 1;
+    }
+
+    return 0;
+}
+
+int find_in_set(int *U, int i_start, int i_end, int i_step,
+                const struct value_set *set, int **ind_val){
+    int i, size;
+    int c = 0;
+
+    size = SET_FIND_INITIAL_SIZE;
+    (*ind_val) = malloc(size * sizeof(int));
+
+    for(i = i_start; i < i_end; i += i_step){
+        if(value_set_contains(set, U[i]))
+            append_index(ind_val, &size, c++, i);
+    }
+
+    (*ind_val) = realloc((*ind_val), max(c, 1) * sizeof(int));
+
+    return c;
+}
+
+//-----------------------------------------------------------------------------
+// The vectorial probes
+//-----------------------------------------------------------------------------
+
+/**
+ * Everything set_mask needs, broadcasted once per search.
+ */
+struct set_probe{
+    const struct value_set *set;
+    __m256i min_vect;
+    __m256i max_vect;
+    __m256i empty_vect;
+    __m256i mult_vect;
+    __m256i mask_vect;
+    __m128i shift;
+};
+
+VECT_INLINE void set_probe_init(struct set_probe *p,
+                                const struct value_set *set){
+    p->set = set;
+    p->min_vect = _mm256_set1_epi32(set->min);
+    p->max_vect = _mm256_set1_epi32(set->max);
+    p->empty_vect = _mm256_set1_epi32(VALUE_SET_EMPTY);
+    p->mult_vect = _mm256_set1_epi32((int) VALUE_SET_HASH_MULT);
+    p->mask_vect = _mm256_set1_epi32((int) set->mask);
+    p->shift = _mm_cvtsi32_si128(set->shift);
+}
+
+/**
+ * Returns an 8 bits mask whose j-th bit is set iff lane j of v is in the set
+ * (among the lanes set in lanes).
+ *
+ * Bitmap: the lanes within [min, max] gather the 32 bits word holding their
+ * bit, which a variable shift brings down to bit 0.
+ *
+ * Hash table: every lane starts at its own slot and gathers the key there.
+ * A lane is done when that key is its value (a hit) or the empty key (a
+ * miss), the other ones move to the next slot and gather again: we loop as
+ * long as one lane of the block is still probing, which at most half full
+ * rarely takes more than a couple of rounds.
+ */
+VECT_INLINE unsigned int set_mask(const struct set_probe *p, __m256i v,
+                                  unsigned int lanes){
+    unsigned int in, hits, pending, found;
+    __m256i off, words, slots, keys;
+
+    if(p->set->kind == VALUE_SET_BITMAP){
+        in = vect_range_mask(v, p->min_vect, p->max_vect) & lanes;
+        if(!in)
+            return 0;
+
+        off = _mm256_sub_epi32(v, p->min_vect);
+        words = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(),
+                                            (int*) p->set->bits,
+                                            _mm256_srli_epi32(off, 5),
+                                            vect_lane_mask(in), 4);
+        words = _mm256_srlv_epi32(words, _mm256_and_si256(off,
+                                                _mm256_set1_epi32(31)));
+
+        return vect_eq_mask(_mm256_and_si256(words, _mm256_set1_epi32(1)),
+                            _mm256_set1_epi32(1)) & in;
+    }
+
+    // The empty key can't be looked for in the table itself
+    found = vect_eq_mask(v, p->empty_vect) & lanes;
+    hits = p->set->empty_member ? found : 0;
+    pending = lanes & ~found;
+
+    slots = _mm256_srl_epi32(_mm256_mullo_epi32(v, p->mult_vect), p->shift);
+    while(pending){
+        keys = _mm256_mask_i32gather_epi32(p->empty_vect, p->set->keys, slots,
+                                           vect_lane_mask(pending), 4);
+        found = vect_eq_mask(keys, v) & pending;
+        hits |= found;
+        pending &= ~(found | vect_eq_mask(keys, p->empty_vect));
+
+        slots = _mm256_and_si256(_mm256_add_epi32(slots,
+                                                  _mm256_set1_epi32(1)),
+                                 p->mask_vect);
+    }
+
+    return hits;
+}
+
+int vect_find_in_set(int *U, int i_start, int i_end, int i_step,
+                     const struct value_set *set, int **ind_val){
+    int base, size;
+    int c = 0;
+    unsigned int mask, lanes;
+    struct vect_scan sc;
+    struct set_probe p;
+
+    __m256i v __attribute__ ((aligned(32)));
+
+    set_probe_init(&p, set);
+
+    size = SET_FIND_INITIAL_SIZE;
+    (*ind_val) = malloc(size * sizeof(int));
+
+    vect_scan_init(&sc, U, i_start, i_end, i_step);
+    while(vect_scan_next(&sc, &base, &v, &lanes)){
+        mask = set_mask(&p, v, lanes);
+
+        while(mask){
+            append_index(ind_val, &size, c++,
+                         base + i_step * __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+
+    (*ind_val) = realloc((*ind_val), max(c, 1) * sizeof(int));
+
+    return c;
+}
+
+int vect_count_in_set(int *U, int i_start, int i_end, int i_step,
+                      const struct value_set *set){
+    int base;
+    int c = 0;
+    unsigned int lanes;
+    struct vect_scan sc;
+    struct set_probe p;
+
+    __m256i v __attribute__ ((aligned(32)));
+
+    set_probe_init(&p, set);
+
+    vect_scan_init(&sc, U, i_start, i_end, i_step);
+    while(vect_scan_next(&sc, &base, &v, &lanes)){
+        c += __builtin_popcount(set_mask(&p, v, lanes));
+    }
+
+    return c;
+}
+
+int vect_find_in_set_fill(int *U, int i_start, int i_end, int i_step,
+                          const struct value_set *set, int *ind_val,
+                          int max_c){
+    int base;
+    int c = 0;
+    unsigned int mask, lanes;
+    struct vect_scan sc;
+    struct set_probe p;
+
+    __m256i v __attribute__ ((aligned(32)));
+
+    set_probe_init(&p, set);
+
+    vect_scan_init(&sc, U, i_start, i_end, i_step);
+    while(c < max_c && vect_scan_next(&sc, &base, &v, &lanes)){
+        mask = set_mask(&p, v, lanes);
+
+        while(mask && c < max_c){
+            ind_val[c++] = base + i_step * __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+
+    return c;
+}
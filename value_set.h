@@ -0,0 +1,107 @@
+/*
+ * ============================================================================
+ *
+ *       Filename:  value_set.h
+ *
+ *    Description:  Sets of values to look for all at once (think of a list of
+ *                  customer IDs): the positions i such that U[i] is one of
+ *                  them, through a bitmap over their domain when it's small
+ *                  enough or an open-addressing hash table otherwise, both
+ *                  probed 8 elements at a time with AVX2 gathers.
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 06:21:28
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  agent (agent@local)
+ *
+ * ============================================================================
+ */
+
+#ifndef _VALUE_SET_H_
+#define _VALUE_SET_H_
+
+#include <limits.h>
+
+// The representations of a set:
+//  - VALUE_SET_BITMAP: one bit per value of [min, max], a membership test
+//    being a range check and a single gather
+//  - VALUE_SET_HASH: an open-addressing hash table (linear probing, at most
+//    half full), a membership test being a gather per probe
+//  - VALUE_SET_AUTO: the smallest of the two
+#define VALUE_SET_BITMAP    0
+#define VALUE_SET_HASH      1
+#define VALUE_SET_AUTO      2
+
+// No bitmap over more values than that (128MB), whatever we're asked for
+#define VALUE_SET_BITMAP_MAX_BITS   (1LL << 30)
+
+// The keys of the hash table are INT_MIN in its empty slots: whether INT_MIN
+// itself is in the set is kept on the side, in empty_member
+#define VALUE_SET_EMPTY     INT_MIN
+
+// Knuth's multiplicative hash: 2^32 divided by the golden ratio
+#define VALUE_SET_HASH_MULT 0x9E3779B1u
+
+/**
+ * The n distinct values of a set, between min and max, in the kind
+ * representation:
+ *  - bits: bit v - min is set iff v is in the set
+ *  - keys: mask + 1 slots (a power of two), the slot of v being the 32 - shift
+ *    upper bits of v * VALUE_SET_HASH_MULT, or the next free one
+ */
+struct value_set{
+    int kind;
+    int n;
+    int min;
+    int max;
+    unsigned int *bits;
+    int *keys;
+    unsigned int mask;
+    int shift;
+    int empty_member;
+};
+
+/**
+ * Builds the set of the n_values values (duplicates allowed) in the kind
+ * representation. A bitmap that would need more than
+ * VALUE_SET_BITMAP_MAX_BITS bits, or an empty set, gets a hash table instead:
+ * kind tells which one we ended up with.
+ */
+struct value_set* value_set_create(int *values, int n_values, int kind);
+
+void value_set_free(struct value_set *set);
+
+/**
+ * Whether v is in the set.
+ */
+int value_set_contains(const struct value_set *set, int v);
+
+/**
+ * Looks for the elements of U between the indexes i_start and i_end (with a
+ * step of i_step) that are in set, one at a time. Returns their number and
+ * puts their positions in *ind_val, like find does.
+ */
+int find_in_set(int *U, int i_start, int i_end, int i_step,
+                const struct value_set *set, int **ind_val);
+
+/**
+ * The vectorial counterpart of find_in_set: every block of 8 elements gets
+ * probed at once (see value_set.c), the result array growing geometrically.
+ */
+int vect_find_in_set(int *U, int i_start, int i_end, int i_step,
+                     const struct value_set *set, int **ind_val);
+
+/**
+ * The two passes of vect_find_in_set, as vect_count and vect_find_fill are
+ * those of vect_find.
+ */
+int vect_count_in_set(int *U, int i_start, int i_end, int i_step,
+                      const struct value_set *set);
+
+int vect_find_in_set_fill(int *U, int i_start, int i_end, int i_step,
+                          const struct value_set *set, int *ind_val,
+                          int max_c);
+
+#endif
@@ -0,0 +1,280 @@
+/*
+ * ============================================================================
+ *
+ *       Filename:  vect_utils.h
+ *
+ *    Description:  The building blocks shared by our vectorial kernels:
+ *                  walking through [i_start, i_end) by blocks of 8 elements
+ *                  that are i_step apart, loading each block into one 256
+ *                  bits register, whatever the alignment of U + i_start.
+ *
+ *        Version:  1.0
+ *        Created:  19/10/2026 05:55:19
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  agent (agent@local)
+ *
+ * ============================================================================
+ */
+
+#ifndef _VECT_UTILS_H_
+#define _VECT_UTILS_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <immintrin.h>
+
+#include "trace.h"
+
+// These are called once per block of 8 elements, we really want them inlined
+// even when we compile without optimizations
+#define VECT_INLINE static inline __attribute__((always_inline))
+
+/**
+ * Everything a kernel needs to know to load U[i], U[i + i_step], ...,
+ * U[i + 7*i_step] in a single register:
+ *  - for i_step = 1 it's a simple load
+ *  - for i_step = 2, 3 and 4 we load the i_step contiguous registers covering
+ *    these 8 elements and deinterleave them with shuffles (permutes + blends),
+ *    which is cheap since we'd have fetched the same cache lines anyway
+ *  - for larger steps, the elements live in different cache lines and we let
+ *    the hardware fetch them with an AVX2 gather
+ */
+struct vect_stride{
+    int i_step;
+    // How many elements after i a full block reads: the blocks that would go
+    // past i_end get their last lanes masked off instead
+    int span;
+    // The gather offsets (0, i_step, ..., 7*i_step)
+    __m256i gather_idx;
+};
+
+VECT_INLINE void vect_stride_init(struct vect_stride *st, int i_step){
+    st->i_step = i_step;
+    st->span = (i_step <= 4) ? 8 * i_step : 7 * i_step + 1;
+    st->gather_idx = _mm256_mullo_epi32(_mm256_set1_epi32(i_step),
+                                        _mm256_setr_epi32(0, 1, 2, 3,
+                                                          4, 5, 6, 7));
+}
+
+/**
+ * Loads U[i], U[i + i_step], ..., U[i + 7*i_step]. For i_step = 1, U + i must
+ * be 32 bytes aligned, the other steps don't care.
+ */
+VECT_INLINE __m256i vect_load_strided(const struct vect_stride *st, int *U,
+                                      int i){
+    __m256i p[4];
+    int j;
+
+    if(st->i_step == 1)
+        return *((__m256i*)(U + i));
+
+    if(st->i_step <= 4){
+        for(j = 0; j < st->i_step; j++)
+            p[j] = _mm256_loadu_si256((__m256i*)(U + i + 8 * j));
+    }
+
+    switch(st->i_step){
+        case 2:
+            // Even elements of both registers in their lower (resp. upper)
+            // half, then a blend keeps the right halves
+            return _mm256_blend_epi32(
+                _mm256_permutevar8x32_epi32(p[0],
+                    _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6)),
+                _mm256_permutevar8x32_epi32(p[1],
+                    _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6)), 0xF0);
+        case 3:
+            // Elements 0, 3, 6 of the first register, 1, 4, 7 of the second
+            // one and 2, 5 of the last one
+            return _mm256_blend_epi32(_mm256_blend_epi32(
+                _mm256_permutevar8x32_epi32(p[0],
+                    _mm256_setr_epi32(0, 3, 6, 0, 0, 0, 0, 0)),
+                _mm256_permutevar8x32_epi32(p[1],
+                    _mm256_setr_epi32(0, 0, 0, 1, 4, 7, 0, 0)), 0x38),
+                _mm256_permutevar8x32_epi32(p[2],
+                    _mm256_setr_epi32(0, 0, 0, 0, 0, 0, 2, 5)), 0xC0);
+        case 4:
+            // Elements 0 and 4 of each of the 4 registers
+            return _mm256_blend_epi32(_mm256_blend_epi32(
+                _mm256_permutevar8x32_epi32(p[0],
+                    _mm256_setr_epi32(0, 4, 0, 4, 0, 4, 0, 4)),
+                _mm256_permutevar8x32_epi32(p[1],
+                    _mm256_setr_epi32(0, 4, 0, 4, 0, 4, 0, 4)), 0x0C),
+                _mm256_blend_epi32(
+                _mm256_permutevar8x32_epi32(p[2],
+                    _mm256_setr_epi32(0, 4, 0, 4, 0, 4, 0, 4)),
+                _mm256_permutevar8x32_epi32(p[3],
+                    _mm256_setr_epi32(0, 4, 0, 4, 0, 4, 0, 4)), 0xC0), 0xF0);
+        default:
+            return _mm256_i32gather_epi32(U + i, st->gather_idx, 4);
+    }
+}
+
+/**
+ * The lanes [lo, hi) of an 8 bits mask.
+ */
+VECT_INLINE unsigned int vect_lanes(int lo, int hi){
+    return (0xFFu >> (8 - hi)) & (0xFFu << lo) & 0xFFu;
+}
+
+/**
+ * Turns an 8 bits mask into a register whose j-th lane is all ones iff bit j
+ * is set, all zeros otherwise.
+ */
+VECT_INLINE __m256i vect_lane_mask(unsigned int lanes){
+    return _mm256_cmpeq_epi32(
+        _mm256_and_si256(_mm256_set1_epi32(lanes),
+                         _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128)),
+        _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128));
+}
+
+/**
+ * Loads the lanes of a block set in lanes only, the other ones are zeroed.
+ * Nothing outside of these lanes is read so it can't fault: that's how we deal
+ * with the (partial) first and last blocks of a range.
+ *
+ * i may be negative (the first block of a vect_scan of an unaligned U starts
+ * before U), so the address of the block is computed as an integer: U + i
+ * would be an out of bounds pointer, which C doesn't allow us to even form.
+ */
+VECT_INLINE __m256i vect_load_lanes(const struct vect_stride *st, int *U,
+                                    int i, unsigned int lanes){
+    __m256i lane_mask;
+    uintptr_t addr;
+
+    lane_mask = vect_lane_mask(lanes);
+    addr = (uintptr_t) U + (uintptr_t)(intptr_t) i * sizeof(int);
+
+    if(st->i_step == 1)
+        return _mm256_maskload_epi32((int*) addr, lane_mask);
+
+    return _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (int*) addr,
+                                       st->gather_idx, lane_mask, 4);
+}
+
+/**
+ * Walks through [i_start, i_end) by blocks of 8 elements i_step apart:
+ *
+ *   struct vect_scan sc;
+ *   vect_scan_init(&sc, U, i_start, i_end, i_step);
+ *   while(vect_scan_next(&sc, &base, &v, &lanes)){
+ *       // lane j of v holds U[base + j*i_step] iff bit j of lanes is set
+ *   }
+ *
+ * For i_step = 1, when U + i_start isn't 32 bytes aligned, the first block
+ * starts at the aligned address right before it with its first lanes masked
+ * off (a masked load doesn't touch them). base is then i_start minus a few
+ * lanes, possibly negative: only vect_load_lanes turns it into an address.
+ * All the following blocks are then plain aligned loads, apart from the last
+ * one which is a masked load again when [i_start, i_end) doesn't end on a
+ * block boundary. Any buffer and any subrange of it can therefore be scanned
+ * at full speed.
+ */
+struct vect_scan{
+    struct vect_stride st;
+    int *U;
+    int i;
+    int i_end;
+};
+
+VECT_INLINE void vect_scan_init(struct vect_scan *sc, int *U, int i_start,
+                                int i_end, int i_step){
+    vect_stride_init(&sc->st, i_step);
+    sc->U = U;
+    sc->i = i_start;
+    sc->i_end = i_end;
+}
+
+VECT_INLINE int vect_scan_next(struct vect_scan *sc, int *base, __m256i *v,
+                               unsigned int *lanes){
+    int off, i = sc->i;
+
+    if(i >= sc->i_end)
+        return 0;
+
+    if(sc->st.i_step == 1){
+        off = (int)(((uintptr_t)(sc->U + i) & 31) / sizeof(int));
+        *base = i - off;
+        sc->i = *base + 8;
+
+        if(off == 0 && sc->i <= sc->i_end){
+            *v = *((__m256i*)(sc->U + *base));
+            *lanes = 0xFF;
+        } else {
+            *lanes = vect_lanes(off, sc->i <= sc->i_end ?
+                                        8 : sc->i_end - *base);
+            *v = vect_load_lanes(&sc->st, sc->U, *base, *lanes);
+        }
+    } else {
+        *base = i;
+        sc->i = i + 8 * sc->st.i_step;
+
+        if(i + sc->st.span <= sc->i_end){
+            *v = vect_load_strided(&sc->st, sc->U, i);
+            *lanes = 0xFF;
+        } else {
+            // Only the lanes before i_end, rounded up to the next step
+            *lanes = vect_lanes(0, (sc->i_end - i + sc->st.i_step - 1) /
+                                    sc->st.i_step);
+            *v = vect_load_lanes(&sc->st, sc->U, i, *lanes);
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * Returns an 8 bits mask whose j-th bit is set iff lane j of v equals val
+ * (cmp_vect being val broadcasted in all 8 lanes).
+ */
+VECT_INLINE unsigned int vect_eq_mask(__m256i v, __m256i cmp_vect){
+    return _mm256_movemask_ps(_mm256_castsi256_ps(
+                _mm256_cmpeq_epi32(cmp_vect, v)));
+}
+
+/**
+ * Returns an 8 bits mask whose j-th bit is set iff lo <= lane j of v <= hi
+ * (lo_vect and hi_vect being lo and hi broadcasted). AVX2 only has a signed
+ * greater-than, so we check that max(v, lo) and min(v, hi) are v itself,
+ * which doesn't overflow for lo = INT_MIN or hi = INT_MAX.
+ */
+VECT_INLINE unsigned int vect_range_mask(__m256i v, __m256i lo_vect,
+                                         __m256i hi_vect){
+    return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(
+                _mm256_cmpeq_epi32(_mm256_max_epi32(v, lo_vect), v),
+                _mm256_cmpeq_epi32(_mm256_min_epi32(v, hi_vect), v))));
+}
+
+/**
+ * dst[i] += src[i] for every i in [0, n), 8 of them at a time: that's how the
+ * copies of a histogram are merged.
+ */
+VECT_INLINE void vect_add_ints(int *dst, const int *src, int n){
+    int i;
+
+    for(i = 0; i + 8 <= n; i += 8)
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_add_epi32(
+            _mm256_loadu_si256((__m256i*)(dst + i)),
+            _mm256_loadu_si256((__m256i*)(src + i))));
+
+    for( ; i < n; i++)
+        dst[i] += src[i];
+}
+
+/**
+ * Stores j at the end of the c indexes of *ind_val, doubling its size (*size
+ * ints) when it's full: that's how the kernels that don't count first grow
+ * their result arrays.
+ */
+VECT_INLINE void append_index(int **ind_val, int *size, int c, int j){
+    if(c == *size){
+        TRACE_BEGIN(t_realloc);
+        *size *= 2;
+        (*ind_val) = realloc((*ind_val), *size * sizeof(int));
+        TRACE_END(t_realloc, "realloc");
+    }
+    (*ind_val)[c] = j;
+}
+
+#endif